@@ -0,0 +1,109 @@
+/*
+ * 请求级内存池实现文件
+ * 设计要点：块链表 + 指针递增分配，大对象单独成块，Reset 后合并为单块以便复用
+ */
+
+#include "arena.h"
+#include "slabpool.h"
+
+const size_t Arena::SLAB_DATA_SIZE = SlabPool::SLAB_SIZE - sizeof(Arena::Block);
+
+Arena::Arena(size_t blockSize)
+    : head_(nullptr),
+      blockSize_(blockSize),
+      usedBefore_(0) {
+    assert(blockSize_ > 0);
+}
+
+Arena::~Arena() {
+    Release();
+}
+
+void Arena::Release() {
+    while (head_) {
+        Block* next = head_->next;
+        FreeBlock_(head_);
+        head_ = next;
+    }
+    usedBefore_ = 0;
+}
+
+void* Arena::Allocate(size_t size, size_t align) {
+    assert(align && (align & (align - 1)) == 0);
+    if (head_) {
+        uintptr_t base = reinterpret_cast<uintptr_t>(head_->Data());
+        size_t offset = ((base + head_->used + align - 1) & ~(align - 1)) - base;
+        if (offset + size <= head_->size) {
+            head_->used = offset + size;
+            return head_->Data() + offset;
+        }
+    }
+    // 当前块不足：新块至少容纳本次分配（含对齐余量）
+    Block* block = NewBlock_(size + align);
+    if (head_) { usedBefore_ += head_->used; }
+    block->next = head_;
+    head_ = block;
+    uintptr_t base = reinterpret_cast<uintptr_t>(block->Data());
+    size_t offset = ((base + align - 1) & ~(align - 1)) - base;
+    block->used = offset + size;
+    return block->Data() + offset;
+}
+
+char* Arena::CopyString(const char* data, size_t len) {
+    char* dst = static_cast<char*>(Allocate(len + 1, 1));
+    memcpy(dst, data, len);
+    dst[len] = '\0';
+    return dst;
+}
+
+void Arena::Reset() {
+    if (!head_) { return; }
+    size_t total = BytesReserved();
+    if (head_->next || total > MAX_KEEP_BYTES) {
+        // 本轮用了多块：合并成一整块，请求大小稳定后只在这一块内分配；
+        // 偶发的超大请求不长期占用内存
+        while (head_) {
+            Block* next = head_->next;
+            FreeBlock_(head_);
+            head_ = next;
+        }
+        if (total <= MAX_KEEP_BYTES) { head_ = NewBlock_(total); }
+    }
+    if (head_) { head_->used = 0; }
+    usedBefore_ = 0;
+}
+
+size_t Arena::BytesUsed() const {
+    return usedBefore_ + (head_ ? head_->used : 0);
+}
+
+size_t Arena::BytesReserved() const {
+    size_t total = 0;
+    for (Block* b = head_; b; b = b->next) { total += b->size; }
+    return total;
+}
+
+// 放得进一个 slab 的块取自 SlabPool（容量补足到整个 slab），连接空闲时 Release 归还池而不是系统
+Arena::Block* Arena::NewBlock_(size_t minSize) {
+    size_t size = minSize > blockSize_ ? minSize : blockSize_;
+    Block* block;
+    if (size <= SLAB_DATA_SIZE) {
+        size = SLAB_DATA_SIZE;
+        block = reinterpret_cast<Block*>(SlabPool::Instance()->Acquire());
+    } else {
+        block = static_cast<Block*>(malloc(sizeof(Block) + size));
+    }
+    if (!block) { throw std::bad_alloc(); }
+    block->next = nullptr;
+    block->size = size;
+    block->used = 0;
+    return block;
+}
+
+void Arena::FreeBlock_(Block* block) {
+    if (block->size == SLAB_DATA_SIZE) {
+        SlabPool::Instance()->Release(reinterpret_cast<char*>(block));
+    } else {
+        free(block);
+    }
+}
@@ -0,0 +1,73 @@
+/*
+ * 请求级内存池（bump 分配器）
+ * 功能：按块向系统申请内存，分配只移动指针；Reset() 时整体回收并保留内存，
+ *       同一连接上的后续请求复用同一块内存，不再逐个 new/delete
+ */
+
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+#include <cstdint>
+#include <new>          // std::bad_alloc
+#include <cassert>
+
+class Arena {
+public:
+	// 构造函数：blockSize 为每次向系统申请的最小块大小（首块惰性分配）
+	explicit Arena(size_t blockSize = 4096);
+
+	~Arena();
+
+	Arena(const Arena &) = delete;
+
+	Arena &operator=(const Arena &) = delete;
+
+	// 分配 size 字节，按 align 对齐（align 须为 2 的幂）
+	void *Allocate(size_t size, size_t align = alignof(std::max_align_t));
+
+	// 分配 n 个 T 的未初始化空间
+	template<class T>
+	T *AllocateArray(size_t n) {
+		return static_cast<T *>(Allocate(n * sizeof(T), alignof(T)));
+	}
+
+	// 复制一段字节并追加 '\0'
+	char *CopyString(const char *data, size_t len);
+
+	// 回收全部分配；若用到了多块，则合并成一块总大小相同的块（超过 MAX_KEEP_BYTES 时全部归还）
+	void Reset();
+
+	// 回收全部分配并把内存全部归还系统（连接空闲时使用）
+	void Release();
+
+	// 当前已分配的字节数（含对齐填充）
+	size_t BytesUsed() const;
+
+	// 向系统申请的总字节数
+	size_t BytesReserved() const;
+
+private:
+	struct Block {
+		Block *next;
+		size_t size;     // data 区容量
+		size_t used;
+		// data 紧随其后
+		char *Data() { return reinterpret_cast<char *>(this + 1); }
+	};
+
+	Block *NewBlock_(size_t minSize);
+
+	static void FreeBlock_(Block *block);
+
+	static const size_t MAX_KEEP_BYTES = 1024 * 1024;  // Reset 后最多保留的内存
+	static const size_t SLAB_DATA_SIZE;                // 取自 slab 的块的 data 区容量
+
+	Block *head_;        // 当前分配所在的块，next 链接更早的块
+	size_t blockSize_;
+	size_t usedBefore_;  // head_ 之前各块已用字节数之和
+};
+
+#endif //ARENA_H
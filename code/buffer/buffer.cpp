@@ -1,16 +1,30 @@
 /*
  * 网络通信缓冲区实现文件
  * 最后更新时间：2025-03-18 12:46 星期二
- * 设计要点：基于vector的动态内存管理、原子操作保证线程安全、支持高效I/O操作
+ * 设计要点：小容量存储区取自 slab 池、空闲时可整体归还、单一所有者（读写位置不加同步）、支持高效I/O操作
  */
 
 #include "buffer.h"
+#include <new>          // std::bad_alloc
+
+const size_t Buffer::OVERFLOW_SIZE;
+const size_t Buffer::MAX_DIRECT_READ;
 
 // 构造函数：初始化存储空间和读写位置
 Buffer::Buffer(int initialSize)
-    : storage(initialSize),  // 预分配指定大小的内存
+    : storage(nullptr),
+      capacity(0),
       readPosition(0),      // 读起始位置初始化
-      writePosition(0) {}   // 写起始位置初始化
+      writePosition(0) {    // 写起始位置初始化
+    if(initialSize > 0) {
+        capacity = initialSize;
+        storage = Allocate_(&capacity);  // 预分配指定大小的内存
+    }
+}
+
+Buffer::~Buffer() {
+    Free_(storage, capacity);
+}
 
 // 获取可读数据长度（写位置 - 读位置）
 size_t Buffer::GetReadableBytes() const {
@@ -19,7 +33,7 @@ size_t Buffer::GetReadableBytes() const {
 
 // 获取可写空间长度（总容量 - 写位置）
 size_t Buffer::GetWritableBytes() const {
-    return storage.size() - writePosition;
+    return capacity - writePosition;
 }
 
 // 获取可回收空间长度（读位置之前的空间）
@@ -35,7 +49,10 @@ const char* Buffer::GetReadPointer() const {
 // 消费指定长度的数据（移动读位置）
 void Buffer::ConsumeData(size_t length) {
     assert(length <= GetReadableBytes());
-    readPosition += length;  // 原子操作保证线程安全
+    readPosition += length;
+    if(readPosition == writePosition) {
+        readPosition = writePosition = 0;  // 读空后回到头部，下次追加无需整理
+    }
 }
 
 // 消费数据直到指定指针位置（用于协议解析）
@@ -46,9 +63,18 @@ void Buffer::ConsumeUntil(const char* end) {
 
 // 重置缓冲区（清空数据并复位指针）
 void Buffer::ResetReadWritePositions() {
-    bzero(&storage[0], storage.size());  // 清空内存内容
-    readPosition = 0;                     // 原子读操作
-    writePosition = 0;                    // 原子写操作
+    readPosition = 0;
+    writePosition = 0;
+}
+
+// 空闲时释放存储区
+void Buffer::Release() {
+    if(GetReadableBytes() > 0) { return; }
+    Free_(storage, capacity);
+    storage = nullptr;
+    capacity = 0;
+    readPosition = 0;
+    writePosition = 0;
 }
 
 // 获取所有可读数据并重置缓冲区
@@ -71,7 +97,7 @@ char* Buffer::GetWritePointer() {
 // 提交已写入的数据长度（移动写位置）
 /*HasWritten*/
 void Buffer::CommitWrite(size_t length) {
-    writePosition += length;  // 原子操作保证线程安全
+    writePosition += length;
 }
 
 /******************** 数据追加操作 ********************/
@@ -107,17 +133,23 @@ void Buffer::EnsureWriteCapacity(size_t len) {
 }
 /******************** I/O 操作 ********************/
 // 从文件描述符读取数据（支持大文件读取）
+// 先用 FIONREAD 取内核中已到达的字节数，把主缓冲区一次扩到位直接读入；
+// 溢出区只接住 ioctl 之后才到达的数据，是每线程一块的堆内存，不再每次占用 64KB 栈
 ssize_t Buffer::ReadFromFD(int fd, int* errorCode) {
-    char tempBuffer[65535];  // 临时缓冲区（64KB）
+    static thread_local std::vector<char> overflow(OVERFLOW_SIZE);
+    int pending = 0;
+    if(ioctl(fd, FIONREAD, &pending) == 0 && pending > 0) {
+        EnsureWriteCapacity(std::min(static_cast<size_t>(pending), MAX_DIRECT_READ));
+    }
     struct iovec ioBlocks[2]; // 分散读结构体
 
     const size_t availableSpace = GetWritableBytes();
     // 第一块：当前缓冲区可用空间
     ioBlocks[0].iov_base = GetWritePointer();
     ioBlocks[0].iov_len = availableSpace;
-    // 第二块：临时缓冲区作为溢出存储
-    ioBlocks[1].iov_base = tempBuffer;
-    ioBlocks[1].iov_len = sizeof(tempBuffer);
+    // 第二块：线程溢出区
+    ioBlocks[1].iov_base = overflow.data();
+    ioBlocks[1].iov_len = overflow.size();
 
     const ssize_t bytesRead = readv(fd, ioBlocks, 2);
     if(bytesRead < 0) {
@@ -129,7 +161,7 @@ ssize_t Buffer::ReadFromFD(int fd, int* errorCode) {
         CommitWrite(bytesRead);  // 全部存入主缓冲区
     } else {
         CommitWrite(availableSpace);  // 填满主缓冲区
-        Append(tempBuffer, bytesRead - availableSpace); // 剩余存入临时区
+        Append(overflow.data(), bytesRead - availableSpace); // 剩余从溢出区追加
     }
     return bytesRead;  // 返回实际读取字节数
 }
@@ -149,21 +181,49 @@ ssize_t Buffer::WriteToFD(int fd, int* errorCode) {
 /******************** 内部实现 ********************/
 // 获取存储空间起始地址（可修改版本）
 char* Buffer::GetBufferStart_() {
-    return &*storage.begin();  // vector迭代器转原生指针
+    return storage;
 }
 
 // 获取存储空间起始地址（常量版本）
 const char* Buffer::GetBufferStart_() const {
-    return &*storage.begin();
+    return storage;
+}
+
+char* Buffer::Allocate_(size_t* capacity) {
+    if(*capacity <= SlabPool::SLAB_SIZE) {
+        *capacity = SlabPool::SLAB_SIZE;
+        return SlabPool::Instance()->Acquire();
+    }
+    char* data = static_cast<char*>(malloc(*capacity));
+    if(!data) { throw std::bad_alloc(); }
+    return data;
+}
+
+void Buffer::Free_(char* data, size_t capacity) {
+    if(!data) { return; }
+    if(capacity == SlabPool::SLAB_SIZE) {
+        SlabPool::Instance()->Release(data);
+    } else {
+        free(data);
+    }
 }
 
 // 内存空间管理核心算法（整理或扩容）
 void Buffer::ManageBufferSpace_(size_t required) {
     size_t min_required = required - GetWritableBytes();
     if (min_required > GetReclaimableBytes()) {
-        // 几何增长：新容量 = 当前容量 * 1.5 与需求取较大值
-        size_t new_capacity = std::max(storage.size()  * 3 / 2, writePosition + required);
-        storage.resize(new_capacity);
+        // 几何增长：新容量 = 当前容量 * 1.5 与需求取较大值，换到新存储区时顺带整理
+        size_t storedDataLength = GetReadableBytes();
+        size_t newCapacity = std::max(capacity * 3 / 2, storedDataLength + required);
+        char* newStorage = Allocate_(&newCapacity);
+        if(storedDataLength > 0) {
+            memcpy(newStorage, GetBufferStart_() + readPosition, storedDataLength);
+        }
+        Free_(storage, capacity);
+        storage = newStorage;
+        capacity = newCapacity;
+        readPosition = 0;
+        writePosition = storedDataLength;
     } else {
         // 情况2：整理现有空间（移动有效数据到头部）
         size_t storedDataLength = GetReadableBytes();
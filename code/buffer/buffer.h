@@ -1,5 +1,5 @@
 /*
- * 网络通信缓冲区类（线程安全设计）
+ * 网络通信缓冲区类（单一所有者，非线程安全）
  * 功能：提供高效的内存管理机制，支持动态扩容和读写位置追踪
  */
 
@@ -10,17 +10,26 @@
 #include <iostream>     // 输入输出流
 #include <unistd.h>     // 系统调用（如write）
 #include <sys/uio.h>    // 分散/聚集I/O操作
+#include <sys/ioctl.h>  // FIONREAD
 #include <vector>       // 动态数组容器
-#include <atomic>       // 原子操作支持
+#include <cstdlib>      // malloc/free
+
+#include "slabpool.h"
 #include <cassert>     // 断言检查
 
+// 单一所有者使用：读写位置为普通整数，不做任何同步，
+// 跨线程共享时由调用者加锁（如日志缓冲区）或保证同一时刻只有一个线程访问（如连接的读写缓冲区）
 class Buffer {
 public:
-	// 构造函数：初始化缓冲区容量（默认1024字节）
+	// 构造函数：初始化缓冲区容量（默认1024字节，为 0 时首次写入才分配）
 	explicit Buffer(int initialSize = 1024);
 
-	// 默认析构函数（使用vector自动管理内存）
-	~Buffer() = default;
+	// 析构函数：存储区归还池或系统
+	~Buffer();
+
+	Buffer(const Buffer &) = delete;
+
+	Buffer &operator=(const Buffer &) = delete;
 
 	// 可写空间字节数（当前写位置到缓冲区末尾）
 	size_t GetWritableBytes() const;
@@ -46,9 +55,15 @@ public:
 	// 消费数据直到指定指针位置（用于协议解析）
 	void ConsumeUntil(const char *end);
 
-	// 重置读写位置（等效于消费所有数据）
+	// 重置读写位置（等效于消费所有数据），O(1)，不清零内存
 	void ResetReadWritePositions();
 
+	// 没有可读数据时释放存储区（归还 slab 池），之后的写入会重新按需分配
+	void Release();
+
+	// 当前存储区容量
+	size_t Capacity() const { return capacity; }
+
 	// 获取所有可读数据并转为字符串（同时重置读写位置）
 	std::string ReadAllAsString();
 
@@ -74,6 +89,9 @@ public:
 	ssize_t WriteToFD(int fd, int *errorCode);
 
 private:
+	static const size_t OVERFLOW_SIZE = 64 * 1024;       // 每线程溢出区大小
+	static const size_t MAX_DIRECT_READ = 1024 * 1024;   // 按 FIONREAD 预扩容的上限
+
 	// 获取底层数组起始地址（可修改版本）
 	char *GetBufferStart_();
 
@@ -83,12 +101,17 @@ private:
 	// 内存管理核心方法：整理或扩展缓冲区
 	void ManageBufferSpace_(size_t required);
 
-	// 数据存储容器（使用vector实现动态数组）
-	std::vector<char> storage;
+	// 不超过一个 slab 的容量取自 SlabPool（实际容量为整个 slab），更大的直接向系统申请
+	static char *Allocate_(size_t *capacity);
+
+	static void Free_(char *data, size_t capacity);
+
+	// 数据存储区
+	char *storage;
+	size_t capacity;
 
-	// 原子操作的读写位置（保证多线程安全）
-	std::atomic<size_t> readPosition; // 当前读位置索引
-	std::atomic<size_t> writePosition; // 当前写位置索引
+	size_t readPosition; // 当前读位置索引
+	size_t writePosition; // 当前写位置索引
 };
 
 #endif //BUFFER_H
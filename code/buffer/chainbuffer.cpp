@@ -0,0 +1,142 @@
+/*
+ * 链式缓冲区实现文件
+ * 设计要点：只在尾部写、头部读；头部空块延迟移除，避免每次消费都搬动 vector
+ */
+
+#include "chainbuffer.h"
+#include <cstring>
+
+ChainBuffer::ChainBuffer() : head_(0), readable_(0) {}
+
+ChainBuffer::~ChainBuffer() {
+    Clear();
+}
+
+void ChainBuffer::Append(const std::string &data) {
+    Append(data.data(), data.size());
+}
+
+void ChainBuffer::Append(const char *str) {
+    Append(str, strlen(str));
+}
+
+void ChainBuffer::Append(const void *data, size_t len) {
+    assert(data || len == 0);
+    Append(static_cast<const char *>(data), len);
+}
+
+void ChainBuffer::Append(const char *data, size_t len) {
+    while (len > 0) {
+        if (SlabCount() == 0 || slabs_.back().end == SlabPool::SLAB_SIZE) {
+            slabs_.push_back(Slab{SlabPool::Instance()->Acquire(), 0, 0});
+        }
+        Slab &tail = slabs_.back();
+        size_t n = std::min(len, SlabPool::SLAB_SIZE - tail.end);
+        memcpy(tail.data + tail.end, data, n);
+        tail.end += n;
+        readable_ += n;
+        data += n;
+        len -= n;
+    }
+}
+
+int ChainBuffer::Peek(struct iovec *iov, int max) const {
+    int cnt = 0;
+    for (size_t i = head_; i < slabs_.size() && cnt < max; i++) {
+        const Slab &slab = slabs_[i];
+        if (slab.end > slab.begin) {
+            iov[cnt].iov_base = slab.data + slab.begin;
+            iov[cnt].iov_len = slab.end - slab.begin;
+            cnt++;
+        }
+    }
+    return cnt;
+}
+
+void ChainBuffer::ConsumeData(size_t len) {
+    assert(len <= readable_);
+    readable_ -= len;
+    while (len > 0 && head_ < slabs_.size()) {
+        Slab &slab = slabs_[head_];
+        size_t n = std::min(len, slab.end - slab.begin);
+        slab.begin += n;
+        len -= n;
+        if (slab.begin == slab.end && (slab.end == SlabPool::SLAB_SIZE || readable_ == 0)) {
+            SlabPool::Instance()->Release(slab.data);
+            head_++;
+        }
+    }
+    if (head_ == slabs_.size()) {
+        slabs_.clear();
+        head_ = 0;
+    } else if (head_ > 8 && head_ * 2 > slabs_.size()) {
+        slabs_.erase(slabs_.begin(), slabs_.begin() + head_);
+        head_ = 0;
+    }
+}
+
+void ChainBuffer::Clear() {
+    for (size_t i = head_; i < slabs_.size(); i++) {
+        SlabPool::Instance()->Release(slabs_[i].data);
+    }
+    slabs_.clear();
+    head_ = 0;
+    readable_ = 0;
+}
+
+ssize_t ChainBuffer::ReadFromFD(int fd, int *errorCode) {
+    /* 先把新 slab 挂到链尾，读完后归还没用上的 */
+    size_t before = slabs_.size();
+    size_t first = before;
+    struct iovec iov[MAX_READ_SLABS + 1];
+    int cnt = 0;
+    if (SlabCount() > 0 && slabs_.back().end < SlabPool::SLAB_SIZE) {
+        Slab &tail = slabs_.back();
+        iov[cnt].iov_base = tail.data + tail.end;
+        iov[cnt].iov_len = SlabPool::SLAB_SIZE - tail.end;
+        cnt++;
+        first = before - 1;
+    }
+    for (int i = 0; i < MAX_READ_SLABS; i++) {
+        slabs_.push_back(Slab{SlabPool::Instance()->Acquire(), 0, 0});
+        iov[cnt].iov_base = slabs_.back().data;
+        iov[cnt].iov_len = SlabPool::SLAB_SIZE;
+        cnt++;
+    }
+    ssize_t len = readv(fd, iov, cnt);
+    if (len < 0) {
+        *errorCode = errno;
+    }
+    size_t got = len > 0 ? len : 0;
+    size_t tailFree = (first < before) ? SlabPool::SLAB_SIZE - slabs_[first].end : 0;
+    size_t used = before + (got > tailFree ? (got - tailFree + SlabPool::SLAB_SIZE - 1) / SlabPool::SLAB_SIZE : 0);
+    while (slabs_.size() > used) {
+        SlabPool::Instance()->Release(slabs_.back().data);
+        slabs_.pop_back();
+    }
+    if (got > 0) {
+        readable_ += got;
+        for (size_t i = first; i < slabs_.size() && got > 0; i++) {
+            size_t n = std::min(got, SlabPool::SLAB_SIZE - slabs_[i].end);
+            slabs_[i].end += n;
+            got -= n;
+        }
+    }
+    if (SlabCount() == 0) {
+        slabs_.clear();
+        head_ = 0;
+    }
+    return len;
+}
+
+ssize_t ChainBuffer::WriteToFD(int fd, int *errorCode) {
+    struct iovec iov[MAX_WRITE_IOV];
+    int cnt = Peek(iov, MAX_WRITE_IOV);
+    ssize_t len = writev(fd, iov, cnt);
+    if (len < 0) {
+        *errorCode = errno;
+        return -1;
+    }
+    ConsumeData(len);
+    return len;
+}
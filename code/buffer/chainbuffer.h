@@ -0,0 +1,75 @@
+/*
+ * 链式缓冲区
+ * 功能：由若干定长 slab 串成，追加时在尾块写满后再取新块，不做整体扩容和搬移；
+ *       读出的数据以 iovec 形式交给 writev，整块消费完立即归还 slab 池，
+ *       空闲时不占用任何 slab
+ */
+
+#ifndef CHAIN_BUFFER_H
+#define CHAIN_BUFFER_H
+
+#include <string>
+#include <vector>
+#include <unistd.h>
+#include <sys/uio.h>
+#include <errno.h>
+#include <cassert>
+
+#include "slabpool.h"
+
+class ChainBuffer {
+public:
+	ChainBuffer();
+
+	~ChainBuffer();
+
+	ChainBuffer(const ChainBuffer &) = delete;
+
+	ChainBuffer &operator=(const ChainBuffer &) = delete;
+
+	// 可读字节数
+	size_t GetReadableBytes() const { return readable_; }
+
+	void Append(const std::string &data);
+
+	// 字符串字面量直接追加，不构造临时 std::string
+	void Append(const char *str);
+
+	void Append(const char *data, size_t len);
+
+	void Append(const void *data, size_t len);
+
+	// 按顺序填入可读数据所在的各段，最多 max 段，返回段数
+	int Peek(struct iovec *iov, int max) const;
+
+	// 消费 len 字节，读完的 slab 归还池
+	void ConsumeData(size_t len);
+
+	// 清空并归还全部 slab
+	void Clear();
+
+	// 分散读：直接读进尾块剩余空间和新取的 slab，不经过临时缓冲区
+	ssize_t ReadFromFD(int fd, int *errorCode);
+
+	// 聚集写：直接从各 slab 写出
+	ssize_t WriteToFD(int fd, int *errorCode);
+
+	// 当前持有的 slab 数
+	size_t SlabCount() const { return slabs_.size() - head_; }
+
+private:
+	struct Slab {
+		char *data;
+		size_t begin;   // 第一个未读字节
+		size_t end;     // 第一个未写字节
+	};
+
+	static const int MAX_READ_SLABS = 4;    // 单次 ReadFromFD 最多新取的 slab 数
+	static const int MAX_WRITE_IOV = 16;
+
+	std::vector<Slab> slabs_;   // [head_, size) 为有效块
+	size_t head_;
+	size_t readable_;
+};
+
+#endif //CHAIN_BUFFER_H
@@ -0,0 +1,99 @@
+/*
+ * 定长内存块池实现文件
+ * 设计要点：线程本地缓存 + 全局空闲链表，取还多数情况下不加锁
+ */
+
+#include "slabpool.h"
+#include <new>          // std::bad_alloc
+#include <sys/mman.h>   // mmap, munmap
+
+size_t SlabPool::maxIdle = 4096;    // 64MB
+
+SlabPool *SlabPool::Instance() {
+    /* 不析构：分离的工作线程退出时仍可能归还本地缓存 */
+    static SlabPool *pool = new SlabPool();
+    return pool;
+}
+
+SlabPool::LocalCache &SlabPool::Local_() {
+    static thread_local LocalCache cache;
+    return cache;
+}
+
+SlabPool::LocalCache::~LocalCache() {
+    SlabPool::Instance()->PushGlobal_(node, slabs, count);
+    count = 0;
+}
+
+char *SlabPool::Acquire() {
+    LocalCache &local = Local_();
+    if (local.count == 0) {
+        local.count = PopGlobal_(local.node, local.slabs, LocalCache::CAPACITY / 2);
+    }
+    if (local.count > 0) {
+        return local.slabs[--local.count];
+    }
+    return Map_(local.bound);
+}
+
+/* 新块直接向内核要从未用过的页：malloc 可能返回别的线程（别的节点）写过又释放的页，
+   也可能来自共享 arena，在本线程写一遍并不能把它们搬到本节点。
+   绑核线程用 MAP_POPULATE 在本线程内立即缺页，按默认的本地分配策略落在本节点 */
+char *SlabPool::Map_(bool populate) {
+    int flags = MAP_PRIVATE | MAP_ANONYMOUS | (populate ? MAP_POPULATE : 0);
+    void *slab = mmap(nullptr, SLAB_SIZE, PROT_READ | PROT_WRITE, flags, -1, 0);
+    if (slab == MAP_FAILED) { throw std::bad_alloc(); }
+    return static_cast<char *>(slab);
+}
+
+void SlabPool::BindNode(int node) {
+    if (node < 0 || node >= MAX_NODES) { return; }
+    LocalCache &local = Local_();
+    if (node != local.node) {
+        /* 本地缓存中的块属于原节点，先还回去 */
+        Instance()->PushGlobal_(local.node, local.slabs, local.count);
+        local.count = 0;
+        local.node = node;
+    }
+    local.bound = true;
+}
+
+void SlabPool::Release(char *slab) {
+    if (!slab) { return; }
+    LocalCache &local = Local_();
+    if (local.count == LocalCache::CAPACITY) {
+        const size_t half = LocalCache::CAPACITY / 2;
+        PushGlobal_(local.node, local.slabs + half, half);
+        local.count = half;
+    }
+    local.slabs[local.count++] = slab;
+}
+
+size_t SlabPool::IdleCount() {
+    std::lock_guard<std::mutex> locker(mtx_);
+    return idle_;
+}
+
+void SlabPool::PushGlobal_(int node, char **slabs, size_t n) {
+    std::lock_guard<std::mutex> locker(mtx_);
+    for (size_t i = 0; i < n; i++) {
+        if (idle_ < maxIdle) {
+            free_[node].push_back(slabs[i]);
+            idle_++;
+        } else {
+            munmap(slabs[i], SLAB_SIZE);
+        }
+    }
+}
+
+/* 只取本节点的空闲块，本节点没有时宁可新分配，也不用远端内存 */
+size_t SlabPool::PopGlobal_(int node, char **slabs, size_t n) {
+    std::lock_guard<std::mutex> locker(mtx_);
+    size_t got = 0;
+    while (got < n && !free_[node].empty()) {
+        slabs[got++] = free_[node].back();
+        free_[node].pop_back();
+        idle_--;
+    }
+    return got;
+}
@@ -0,0 +1,67 @@
+/*
+ * 定长内存块（slab）池
+ * 功能：按固定大小分配缓冲区内存块；每个线程先在本地缓存中取还，
+ *       不足或过多时再与全局空闲链表批量交换，空闲总量超过上限后归还系统；
+ *       新块用 mmap 取全新的页；绑定了 NUMA 节点的线程只与本节点的空闲链表交换，
+ *       其新块在本线程内立即缺页（first-touch），物理页分配在本节点
+ */
+
+#ifndef SLAB_POOL_H
+#define SLAB_POOL_H
+
+#include <cstddef>
+#include <cstdlib>
+#include <vector>
+#include <mutex>
+
+class SlabPool {
+public:
+	static const size_t SLAB_SIZE = 16 * 1024;
+
+	static SlabPool *Instance();
+
+	// 取一个 SLAB_SIZE 字节的块
+	char *Acquire();
+
+	// 归还由 Acquire 取得的块
+	void Release(char *slab);
+
+	// 全局空闲块数（不含各线程本地缓存）
+	size_t IdleCount();
+
+	// 声明调用线程所在的 NUMA 节点（线程绑核后调用），之后取还都走该节点的空闲链表
+	static void BindNode(int node);
+
+	static size_t maxIdle;      // 全局最多保留的空闲块数
+	static const int MAX_NODES = 8;
+
+private:
+	// 线程本地缓存，满了把一半交给全局，空了从全局批量取
+	struct LocalCache {
+		static const size_t CAPACITY = 32;
+
+		char *slabs[CAPACITY];
+		size_t count = 0;
+		int node = 0;
+		bool bound = false;
+
+		~LocalCache();
+	};
+
+	SlabPool() = default;
+
+	static LocalCache &Local_();
+
+	// 映射一个新块，populate 时立即在调用线程内分配物理页
+	static char *Map_(bool populate);
+
+	void PushGlobal_(int node, char **slabs, size_t n);
+
+	size_t PopGlobal_(int node, char **slabs, size_t n);
+
+	std::mutex mtx_;
+	std::vector<char *> free_[MAX_NODES];   // 按 NUMA 节点分开的空闲链表
+	size_t idle_ = 0;
+};
+
+#endif //SLAB_POOL_H
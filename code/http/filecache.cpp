@@ -0,0 +1,103 @@
+//
+// Created by moon on 25-3-21.
+//
+
+#include "filecache.h"
+#include <cstdio>
+#include <fcntl.h>
+#include <unistd.h>
+
+FileCache *FileCache::Instance() {
+	static FileCache cache;
+	return &cache;
+}
+
+bool FileCache::Lookup(const std::string &path, Entry *out) {
+	struct stat st;
+	if (stat(path.c_str(), &st) < 0) { return false; }
+	{
+		std::shared_lock<std::shared_timed_mutex> locker(mtx_);
+		auto it = entries_.find(path);
+		if (it != entries_.end() && SameFile_(it->second.st, st)) {
+			*out = it->second;
+			return true;
+		}
+	}
+
+	/* 首次访问或文件已变化：重新生成 ETag 和 Last-Modified */
+	Entry entry;
+	entry.st = st;
+	char buf[64];
+	snprintf(buf, sizeof(buf), "\"%lx-%lx-%lx\"", static_cast<unsigned long>(st.st_ino),
+	         static_cast<unsigned long>(st.st_size), static_cast<unsigned long>(st.st_mtime));
+	entry.etag = buf;
+	FormatHttpDate(st.st_mtime, buf);
+	entry.lastModified = buf;
+	*out = entry;
+
+	std::unique_lock<std::shared_timed_mutex> locker(mtx_);
+	if (entries_.size() >= MAX_ENTRIES && entries_.count(path) == 0) {
+		entries_.clear();   // 文件集合很小，超过上限说明是异常路径扫描，直接清空
+	}
+	entries_[path] = std::move(entry);
+	return true;
+}
+
+std::shared_ptr<const std::string> FileCache::CachedContent(const std::string &path, const struct stat &st) {
+	std::shared_lock<std::shared_timed_mutex> locker(mtx_);
+	auto it = entries_.find(path);
+	if (it != entries_.end() && it->second.content && SameFile_(it->second.st, st)) {
+		return it->second.content;
+	}
+	return nullptr;
+}
+
+std::shared_ptr<const std::string> FileCache::Content(const std::string &path, const struct stat &st) {
+	std::shared_ptr<const std::string> cached = CachedContent(path, st);
+	if (cached) { return cached; }
+
+	int fd = open(path.c_str(), O_RDONLY);
+	if (fd < 0) { return nullptr; }
+	std::string data(st.st_size, '\0');
+	size_t done = 0;
+	while (done < data.size()) {
+		ssize_t n = read(fd, &data[done], data.size() - done);
+		if (n <= 0) { break; }
+		done += n;
+	}
+	close(fd);
+	if (done != data.size()) { return nullptr; }   // 读取期间文件被修改
+	auto content = std::make_shared<const std::string>(std::move(data));
+
+	/* 只缓存到元数据一致的条目上，条目不存在时仅本次使用 */
+	std::unique_lock<std::shared_timed_mutex> locker(mtx_);
+	auto it = entries_.find(path);
+	if (it != entries_.end() && SameFile_(it->second.st, st)) {
+		it->second.content = content;
+	}
+	return content;
+}
+
+void FileCache::Clear() {
+	std::unique_lock<std::shared_timed_mutex> locker(mtx_);
+	entries_.clear();
+}
+
+bool FileCache::SameFile_(const struct stat &a, const struct stat &b) {
+	return a.st_ino == b.st_ino && a.st_dev == b.st_dev && a.st_size == b.st_size
+	       && a.st_mtim.tv_sec == b.st_mtim.tv_sec && a.st_mtim.tv_nsec == b.st_mtim.tv_nsec
+	       && a.st_mode == b.st_mode;
+}
+
+size_t FileCache::FormatHttpDate(time_t t, char *buf) {
+	struct tm tm;
+	gmtime_r(&t, &tm);
+	return strftime(buf, 30, "%a, %d %b %Y %H:%M:%S GMT", &tm);
+}
+
+time_t FileCache::ParseHttpDate(const std::string &str) {
+	struct tm tm = {};
+	const char *end = strptime(str.c_str(), "%a, %d %b %Y %H:%M:%S GMT", &tm);
+	if (!end || *end != '\0') { return -1; }
+	return timegm(&tm);
+}
@@ -0,0 +1,61 @@
+//
+// Created by moon on 25-3-21.
+//
+
+#ifndef FILE_CACHE_H
+#define FILE_CACHE_H
+
+#include <string>
+#include <unordered_map>
+#include <mutex>
+#include <shared_mutex>
+#include <ctime>
+#include <memory>
+#include <sys/stat.h>    // stat
+
+// 静态文件元数据缓存
+// 每次请求仍 stat 一次以感知文件变化；inode、大小、修改时间不变时
+// 直接复用缓存的 ETag 与 Last-Modified 字符串，不再重复格式化。
+class FileCache {
+public:
+	struct Entry {
+		struct stat st;
+		std::string etag;           // "inode-size-mtime"（十六进制，含引号）
+		std::string lastModified;   // HTTP 日期格式
+		std::shared_ptr<const std::string> content;   // 小文件内容，按需读入
+	};
+
+	static FileCache *Instance();
+
+	// 取文件元数据，stat 失败返回 false（errno 保留）
+	bool Lookup(const std::string &path, Entry *out);
+
+	// 小文件内容：与 st 描述的是同一文件时复用缓存的内容，否则读文件并缓存，失败返回空指针
+	std::shared_ptr<const std::string> Content(const std::string &path, const struct stat &st);
+
+	// 只查缓存、不读文件：未缓存或文件已变化时返回空指针
+	std::shared_ptr<const std::string> CachedContent(const std::string &path, const struct stat &st);
+
+	// 清空缓存
+	void Clear();
+
+	// time_t -> "Sun, 06 Nov 1994 08:49:37 GMT"，buf 至少 30 字节，返回长度
+	static size_t FormatHttpDate(time_t t, char *buf);
+
+	// 解析 HTTP 日期（IMF-fixdate），失败返回 -1
+	static time_t ParseHttpDate(const std::string &str);
+
+private:
+	FileCache() = default;
+
+	~FileCache() = default;
+
+	static bool SameFile_(const struct stat &a, const struct stat &b);
+
+	static const size_t MAX_ENTRIES = 4096;
+
+	std::unordered_map<std::string, Entry> entries_;
+	std::shared_timed_mutex mtx_;
+};
+
+#endif //FILE_CACHE_H
@@ -0,0 +1,111 @@
+//
+// Created by moon on 25-3-22.
+//
+
+#include "gzipcache.h"
+#include <fcntl.h>
+#include <unistd.h>
+#include <zlib.h>
+
+#include "../log/log.h"
+
+size_t GzipCache::maxFileSize = 8 * 1024 * 1024;
+size_t GzipCache::maxBytes = 64 * 1024 * 1024;
+int GzipCache::level = 6;
+
+GzipCache *GzipCache::Instance() {
+	static GzipCache cache;
+	return &cache;
+}
+
+GzipCache::GzipCache() : bytes_(0) {}
+
+bool GzipCache::Find(const std::string &path, const FileCache::Entry &info, std::shared_ptr<const std::string> *out) {
+	out->reset();
+	if (static_cast<size_t>(info.st.st_size) > maxFileSize) { return true; }
+	std::lock_guard<std::mutex> locker(mtx_);
+	auto it = entries_.find(path);
+	if (it != entries_.end() && it->second.etag == info.etag) {
+		*out = it->second.data;
+		return true;
+	}
+	return false;
+}
+
+std::shared_ptr<const std::string> GzipCache::Get(const std::string &path, const FileCache::Entry &info) {
+	size_t size = info.st.st_size;
+	std::shared_ptr<const std::string> cached;
+	if (Find(path, info, &cached)) { return cached; }
+
+	/* 压缩在锁外进行，同一文件并发未命中时可能重复压缩一次，结果相同 */
+	std::shared_ptr<const std::string> data;
+	std::string out;
+	if (CompressFile_(path, size, &out)) {
+		if (out.size() < size) {
+			data = std::make_shared<const std::string>(std::move(out));
+		}
+	} else {
+		return nullptr;
+	}
+
+	std::lock_guard<std::mutex> locker(mtx_);
+	auto it = entries_.find(path);
+	if (it != entries_.end()) {
+		if (it->second.data) { bytes_ -= it->second.data->size(); }
+		entries_.erase(it);
+	}
+	size_t need = data ? data->size() : 0;
+	if (need > maxBytes) { return data; }
+	Evict_(need);
+	entries_[path] = Entry{info.etag, data};
+	bytes_ += need;
+	LOG_DEBUG("gzip %s: %zu -> %zu", path.c_str(), size, need);
+	return data;
+}
+
+void GzipCache::Clear() {
+	std::lock_guard<std::mutex> locker(mtx_);
+	entries_.clear();
+	bytes_ = 0;
+}
+
+bool GzipCache::CompressFile_(const std::string &path, size_t size, std::string *out) {
+	int fd = open(path.c_str(), O_RDONLY);
+	if (fd < 0) { return false; }
+	std::string src(size, '\0');
+	size_t done = 0;
+	while (done < size) {
+		ssize_t n = read(fd, &src[done], size - done);
+		if (n <= 0) { break; }
+		done += n;
+	}
+	close(fd);
+	if (done != size) { return false; }
+	return Compress(src.data(), size, out);
+}
+
+bool GzipCache::Compress(const char *data, size_t len, std::string *out) {
+	z_stream zs = {};
+	/* windowBits 加 16 输出 gzip 格式 */
+	if (deflateInit2(&zs, level, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+		return false;
+	}
+	out->resize(deflateBound(&zs, len));
+	zs.next_in = reinterpret_cast<Bytef *>(const_cast<char *>(data));
+	zs.avail_in = len;
+	zs.next_out = reinterpret_cast<Bytef *>(&(*out)[0]);
+	zs.avail_out = out->size();
+	int ret = deflate(&zs, Z_FINISH);
+	out->resize(zs.total_out);
+	deflateEnd(&zs);
+	return ret == Z_STREAM_END;
+}
+
+void GzipCache::Evict_(size_t need) {
+	/* 文件集合通常很小，超出上限时任意淘汰若干项即可 */
+	auto it = entries_.begin();
+	while (bytes_ + need > maxBytes && it != entries_.end()) {
+		if (it->second.data) { bytes_ -= it->second.data->size(); }
+		it = entries_.erase(it);
+	}
+}
@@ -0,0 +1,57 @@
+//
+// Created by moon on 25-3-22.
+//
+
+#ifndef GZIP_CACHE_H
+#define GZIP_CACHE_H
+
+#include <string>
+#include <memory>
+#include <unordered_map>
+#include <mutex>
+
+#include "filecache.h"
+
+// 静态文件的 gzip 压缩结果缓存
+// 每个文件只在首次被请求（或内容变化后）压缩一次，之后的请求直接发送缓存的字节，
+// 不再消耗 CPU。按 ETag 校验是否过期；结果以 shared_ptr 交给响应，
+// 即使发送途中被淘汰也不会失效。
+class GzipCache {
+public:
+	static GzipCache *Instance();
+
+	// 取 path 的 gzip 压缩内容，文件过大、压缩无收益或读文件失败时返回空指针
+	std::shared_ptr<const std::string> Get(const std::string &path, const FileCache::Entry &info);
+
+	// 只查缓存、不压缩：结果已确定（命中，或文件过大不压缩）时返回 true 并写入 out
+	bool Find(const std::string &path, const FileCache::Entry &info, std::shared_ptr<const std::string> *out);
+
+	void Clear();
+
+	// 将 [data, data + len) 压缩为 gzip 格式
+	static bool Compress(const char *data, size_t len, std::string *out);
+
+	static size_t maxFileSize;   // 参与压缩的最大文件字节数
+	static size_t maxBytes;      // 缓存的压缩数据总字节数上限
+	static int level;            // zlib 压缩级别
+
+private:
+	struct Entry {
+		std::string etag;
+		std::shared_ptr<const std::string> data;   // 压缩无收益时为空，避免重复尝试
+	};
+
+	GzipCache();
+
+	~GzipCache() = default;
+
+	static bool CompressFile_(const std::string &path, size_t size, std::string *out);
+
+	void Evict_(size_t need);
+
+	std::unordered_map<std::string, Entry> entries_;
+	size_t bytes_;
+	std::mutex mtx_;
+};
+
+#endif //GZIP_CACHE_H
@@ -9,11 +9,23 @@ using namespace std;
 const char* HttpConn::srcDir;
 std::atomic<int> HttpConn::userCount;
 bool HttpConn::isET;
+size_t HttpConn::warmChunk = 1024 * 1024;
+size_t HttpConn::coldCheckMin = 256 * 1024;
 
-HttpConn::HttpConn() {
+HttpConn::HttpConn() : readBuff_(0) {
     fd_ = -1;
     addr_ = { 0 };
     isClose_ = true;
+    busy_ = false;
+    closePending_ = false;
+    parsed_ = false;
+    badRequest_ = false;
+    bodyCnt_ = 0;
+    bodyIdx_ = 0;
+    checkedUntil_ = nullptr;
+    warmOffset_ = 0;
+    warmLen_ = 0;
+    corked_ = false;
 };
 
 HttpConn::~HttpConn() {
@@ -25,14 +37,29 @@ void HttpConn::init(int fd, const sockaddr_in& addr) {
     userCount++;
     addr_ = addr;
     fd_ = fd;
-    writeBuff_.ResetReadWritePositions();
+    writeBuff_.Clear();
+    bodyCnt_ = 0;
+    bodyIdx_ = 0;
     readBuff_.ResetReadWritePositions();
+    request_.Init();
     isClose_ = false;
+    busy_ = false;
+    closePending_ = false;
+    parsed_ = false;
+    badRequest_ = false;
+    corked_ = false;
     LOG_INFO("Client[%d](%s:%d) in, userCount:%d", fd_, GetIP(), GetPort(), (int)userCount);
 }
 
 void HttpConn::Close() {
     response_.UnmapFile();
+    readBuff_.ResetReadWritePositions();
+    readBuff_.Release();
+    request_.Init();
+    request_.Release();
+    writeBuff_.Clear();
+    bodyCnt_ = 0;
+    bodyIdx_ = 0;
     if(isClose_ == false){
         isClose_ = true;
         userCount--;
@@ -64,60 +91,195 @@ ssize_t HttpConn::read(int* saveErrno) {
         if (len <= 0) {
             break;
         }
-    } while (isET);
+        /* 大请求体边读边解析，读缓冲区到上限后先交给 process，
+           重新注册 EPOLLIN 时内核会对仍可读的 fd 再次通知 */
+    } while (isET && readBuff_.GetReadableBytes() < READ_BUFF_LIMIT);
     return len;
 }
 
 ssize_t HttpConn::write(int* saveErrno) {
     ssize_t len = -1;
     do {
-        len = writev(fd_, iov_, iovCnt_);
+        if(ColdAhead_()) {
+            *saveErrno = EAGAIN;
+            break;
+        }
+        /* 写缓冲区各 slab 在前，响应体片段在后；写缓冲区没能全部放进本次 iov 时不带响应体 */
+        struct iovec iov[MAX_HEAD_IOV + MAX_BODY_IOV];
+        int cnt = writeBuff_.Peek(iov, MAX_HEAD_IOV);
+        size_t head = 0;
+        for(int i = 0; i < cnt; i++) { head += iov[i].iov_len; }
+        if(head == writeBuff_.GetReadableBytes()) {
+            for(int i = bodyIdx_; i < bodyCnt_; i++) { iov[cnt++] = body_[i]; }
+        }
+        len = writev(fd_, iov, cnt);
         if(len <= 0) {
             *saveErrno = errno;
             break;
         }
-        if(iov_[0].iov_len + iov_[1].iov_len  == 0) { break; } /* 传输结束 */
-        else if(static_cast<size_t>(len) > iov_[0].iov_len) {
-            iov_[1].iov_base = (uint8_t*) iov_[1].iov_base + (len - iov_[0].iov_len);
-            iov_[1].iov_len -= (len - iov_[0].iov_len);
-            if(iov_[0].iov_len) {
-                writeBuff_.ResetReadWritePositions();
-                iov_[0].iov_len = 0;
-            }
-        }
-        else {
-            iov_[0].iov_base = (uint8_t*)iov_[0].iov_base + len;
-            iov_[0].iov_len -= len;
-            writeBuff_.ConsumeData(len);
+        /* 按已发送字节数先消费写缓冲区，再依次推进响应体片段 */
+        size_t left = len;
+        size_t n = std::min(left, head);
+        writeBuff_.ConsumeData(n);
+        left -= n;
+        while(left > 0 && bodyIdx_ < bodyCnt_) {
+            n = std::min(left, body_[bodyIdx_].iov_len);
+            body_[bodyIdx_].iov_base = (uint8_t*)body_[bodyIdx_].iov_base + n;
+            body_[bodyIdx_].iov_len -= n;
+            left -= n;
+            if(body_[bodyIdx_].iov_len == 0) { bodyIdx_++; }
         }
+        if(ToWriteBytes() == 0) { break; } /* 传输结束 */
     } while(isET || ToWriteBytes() > 10240);
+    if(corked_ && ToWriteBytes() == 0) {
+        SetCork_(false);   /* 发完后取消 cork，把最后不满一个报文的数据立即发出 */
+    }
     return len;
 }
 
-bool HttpConn::process() {
-    request_.Init();
+/* 用 mincore 检查下一段待发送的映射是否驻留内存，每段只检查一次；
+   不驻留时记录文件区间，交给 I/O 线程预读，避免工作线程在 writev 中因缺页阻塞在磁盘上 */
+bool HttpConn::ColdAhead_() {
+    const char* file = response_.File();
+    if(bodyIdx_ >= bodyCnt_ || !file || response_.FileLen() < coldCheckMin) { return false; }
+    const char* begin = static_cast<const char*>(body_[bodyIdx_].iov_base);
+    const char* end = begin + body_[bodyIdx_].iov_len;
+    if(begin < file || end > file + response_.FileLen()) { return false; }   /* 不是文件映射 */
+    if(checkedUntil_ > begin) { begin = checkedUntil_; }
+    if(begin >= end) { return false; }
+    if(static_cast<size_t>(end - begin) > warmChunk) { end = begin + warmChunk; }
+    checkedUntil_ = end;
+
+    static const uintptr_t PAGE = sysconf(_SC_PAGESIZE);
+    uintptr_t start = reinterpret_cast<uintptr_t>(begin) & ~(PAGE - 1);
+    size_t pages = (reinterpret_cast<uintptr_t>(end) - start + PAGE - 1) / PAGE;
+    static thread_local std::vector<unsigned char> resident;
+    resident.resize(pages);
+    if(mincore(reinterpret_cast<void*>(start), end - reinterpret_cast<const char*>(start), resident.data()) < 0) {
+        return false;
+    }
+    for(size_t i = 0; i < pages; i++) {
+        if(!(resident[i] & 1)) {
+            warmOffset_ = begin - file;
+            warmLen_ = end - begin;
+            return true;
+        }
+    }
+    return false;
+}
+
+void HttpConn::SetCork_(bool on) {
+    int opt = on ? 1 : 0;
+    if(setsockopt(fd_, IPPROTO_TCP, TCP_CORK, &opt, sizeof(opt)) == 0) {
+        corked_ = on;
+    }
+}
+
+void HttpConn::TakeWarm(std::string* path, off_t* offset, size_t* len) {
+    *path = response_.FilePath();
+    *offset = warmOffset_;
+    *len = warmLen_;
+    warmLen_ = 0;
+}
+
+/* 响应已发完且没有待解析的数据：连接进入空闲，把缓冲区和请求级内存都还回去，
+   空闲的长连接只保留 HttpConn 对象本身 */
+void HttpConn::ReleaseIdle_() {
+    if(ToWriteBytes() > 0) { return; }
+    response_.UnmapFile();
+    readBuff_.Release();
+    request_.Release();
+}
+
+bool HttpConn::process(bool allowBlocking) {
+    if(!parsed_ && !Parse_()) {
+        return false;
+    }
+    parsed_ = true;
+    if(!allowBlocking && NeedBlocking()) {
+        return false;     /* 保留已解析的请求，交给阻塞线程池继续 */
+    }
+    parsed_ = false;
+    request_.RunHandler();
+    Respond_(false);
+    return true;
+}
+
+void HttpConn::Reject(int code) {
+    parsed_ = false;
+    response_.Init(srcDir, request_.path(), request_.IsKeepAlive(), code);
+    response_.MakeResponse(writeBuff_);
+    SetBody_();
+}
+
+HttpConn::InlineResult HttpConn::ProcessInline() {
+    if(!request_.IsIdle() && !request_.IsFinished()) {
+        return INLINE_DEFER;     /* 正在接收的请求（如大请求体）由工作线程继续解析 */
+    }
+    if(readBuff_.GetReadableBytes() > 0 && !HttpRequest::IsStaticRequest(readBuff_)) {
+        return INLINE_DEFER;
+    }
+    if(!Parse_()) {
+        return INLINE_NEED_READ;
+    }
+    if(!badRequest_ && request_.HandlerPending()) {
+        parsed_ = true;
+        return INLINE_DEFER;     /* 已解析的请求带处理函数（如无请求体的 POST），由 process 执行 RunHandler */
+    }
+    if(!Respond_(true)) {
+        parsed_ = true;
+        return INLINE_DEFER;
+    }
+    return INLINE_READY;
+}
+
+/* 解析读缓冲区中的请求，得到完整请求（或解析错误）时返回 true */
+bool HttpConn::Parse_() {
+    if(request_.IsFinished()) {
+        request_.Init();
+    }
     if(readBuff_.GetReadableBytes() <= 0) {
+        ReleaseIdle_();
         return false;
     }
-    else if(request_.parse(readBuff_)) {
+    badRequest_ = !request_.parse(readBuff_);
+    /* 请求尚未完整时继续等待数据 */
+    return badRequest_ || request_.IsFinished();
+}
+
+bool HttpConn::Respond_(bool noBlock) {
+    if(badRequest_) {
+        response_.Init(srcDir, request_.path(), false, request_.ErrorCode());
+    }
+    else {
         LOG_DEBUG("%s", request_.path().c_str());
-        response_.Init(srcDir, request_.path(), request_.IsKeepAlive(), 200);
-    } else {
-        response_.Init(srcDir, request_.path(), false, 400);
+        response_.Init(srcDir, request_.path(), request_.IsKeepAlive(), 200, &request_);
     }
+    response_.SetNoBlock(noBlock);
 
-    response_.MakeResponse(writeBuff_);
-    /* 响应头 */
-    iov_[0].iov_base = const_cast<char*>(writeBuff_.GetReadPointer());
-    iov_[0].iov_len = writeBuff_.GetReadableBytes();
-    iovCnt_ = 1;
-
-    /* 文件 */
-    if(response_.FileLen() > 0  && response_.File()) {
-        iov_[1].iov_base = response_.File();
-        iov_[1].iov_len = response_.FileLen();
-        iovCnt_ = 2;
-    }
-    LOG_DEBUG("filesize:%d, %d  to %d", response_.FileLen() , iovCnt_, ToWriteBytes());
+    /* 响应头（以及内联的小响应体）追加到写缓冲区 */
+    if(!response_.MakeResponse(writeBuff_)) {
+        return false;
+    }
+    SetBody_();
     return true;
 }
+
+void HttpConn::SetBody_() {
+    bodyCnt_ = 0;
+    bodyIdx_ = 0;
+    checkedUntil_ = nullptr;
+    warmLen_ = 0;
+
+    /* 文件（整个文件或各个区间） */
+    for(const struct iovec& seg: response_.Body()) {
+        if(seg.iov_len == 0) { continue; }
+        assert(bodyCnt_ < MAX_BODY_IOV);
+        body_[bodyCnt_++] = seg;
+    }
+    /* 小响应已整体拷进写缓冲区，一次发出；大响应分多次写，cork 住避免产生零碎报文 */
+    if(bodyCnt_ > 0 && !corked_) {
+        SetCork_(true);
+    }
+    LOG_DEBUG("filesize:%d, %d  to %d", response_.FileLen() , bodyCnt_, ToWriteBytes());
+}
@@ -10,17 +10,27 @@
 #include <sys/types.h>
 #include <sys/uio.h>     // readv/writev
 #include <arpa/inet.h>   // sockaddr_in
+#include <netinet/tcp.h> // TCP_CORK
 #include <stdlib.h>      // atoi()
 #include <errno.h>
 
 #include "../log/log.h"
 #include "../pool/sqlconnRAII.h"
 #include "../buffer/buffer.h"
+#include "../buffer/chainbuffer.h"
+#include "../server/completionqueue.h"
 #include "httprequest.h"
 #include "httpresponse.h"
 
 class HttpConn {
 public:
+    /* Reactor 线程内联处理的结果 */
+    enum InlineResult {
+        INLINE_NEED_READ,   // 没有完整的请求，继续等待数据
+        INLINE_DEFER,       // 可能阻塞（动态路由、请求体、冷文件、待压缩），交给工作线程
+        INLINE_READY,       // 响应已就绪，可直接写回
+    };
+
     HttpConn();
 
     ~HttpConn();
@@ -41,32 +51,88 @@ public:
 
     sockaddr_in GetAddr() const;
 
-    bool process();
+    /* allowBlocking 为 false 时，请求解析完但需要执行阻塞的处理函数则停下，由 NeedBlocking 告知调用者 */
+    bool process(bool allowBlocking = true);
+
+    /* 请求已解析完，等待在阻塞线程池中执行处理函数 */
+    bool NeedBlocking() const {
+        return parsed_ && request_.HandlerPending() && request_.HandlerType() == Router::BLOCKING;
+    }
+
+    /* 不执行已解析请求的处理函数，直接以错误码响应（如阻塞线程池已满时的 503） */
+    void Reject(int code);
+
+    /* 只处理不会阻塞的静态请求，不满足条件时不消费读缓冲区，由工作线程调用 process 继续 */
+    InlineResult ProcessInline();
 
     int ToWriteBytes() {
-        return iov_[0].iov_len + iov_[1].iov_len;
+        size_t bytes = writeBuff_.GetReadableBytes();
+        for(int i = bodyIdx_; i < bodyCnt_; i++) { bytes += body_[i].iov_len; }
+        return bytes;
     }
 
     bool IsKeepAlive() const {
         return request_.IsKeepAlive();
     }
 
+    /* 即将发送的文件区间不在页缓存中，需先由 I/O 线程预读再继续发送 */
+    bool NeedWarm() const {
+        return warmLen_ > 0;
+    }
+
+    /* 取出待预读的文件区间并清除标记 */
+    void TakeWarm(std::string* path, off_t* offset, size_t* len);
+
+    /* 以下仅由 Reactor 线程访问：连接交给工作线程期间为 busy，
+       此时到期的超时只做标记，等工作线程投递完成结果后再关闭 */
+    CompletionQueue::Node* CompletionNode() { return &completion_; }
+    bool IsBusy() const { return busy_; }
+    void SetBusy(bool busy) { busy_ = busy; }
+    bool IsClosePending() const { return closePending_; }
+    void SetClosePending(bool pending) { closePending_ = pending; }
+
     static bool isET;
     static const char* srcDir;
     static std::atomic<int> userCount;
+    static size_t warmChunk;       // 每次检查/预读的文件字节数
+    static size_t coldCheckMin;    // 小于该大小的文件不做驻留检查
 
 private:
+    static const size_t READ_BUFF_LIMIT = 1024 * 1024;
+    /* 多区间时每个区间的分隔头和数据 + 结束分隔 */
+    static const int MAX_BODY_IOV = 2 * HttpResponse::MAX_RANGES + 1;
+    static const int MAX_HEAD_IOV = 8;    // 一次 writev 最多带上的写缓冲区 slab 数
 
     int fd_;
     struct  sockaddr_in addr_;
 
     bool isClose_;
+    bool busy_;
+    bool closePending_;
+    CompletionQueue::Node completion_;
+
+    bool parsed_;                  // 请求已在 Reactor 线程解析完，交给工作线程后直接生成响应
+    bool badRequest_;
+
+    int bodyCnt_;
+    int bodyIdx_;                  // 第一个尚未发完的响应体片段，writeBuff_ 中的数据总是先于响应体发出
+    struct iovec body_[MAX_BODY_IOV];
+
+    bool ColdAhead_();
+    void ReleaseIdle_();
+    bool Parse_();
+    bool Respond_(bool noBlock);
+    void SetBody_();
+    void SetCork_(bool on);
+
+    bool corked_;                  // 大响应发送期间合并响应头与文件数据
 
-    int iovCnt_;
-    struct iovec iov_[2];
+    const char* checkedUntil_;     // 映射中已确认驻留（或已预读）的位置
+    off_t warmOffset_;
+    size_t warmLen_;
 
-    Buffer readBuff_; // 读缓冲区
-    Buffer writeBuff_; // 写缓冲区
+    Buffer readBuff_; // 读缓冲区，读空即归还，下次 EPOLLIN 时再按需取
+    ChainBuffer writeBuff_; // 写缓冲区，按 slab 取用，发完即归还
 
     HttpRequest request_;
     HttpResponse response_;
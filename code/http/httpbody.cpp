@@ -0,0 +1,84 @@
+//
+// Created by moon on 25-3-20.
+//
+
+#include "httpbody.h"
+#include <stdlib.h>      // mkstemp
+
+size_t HttpBody::spillThreshold = 64 * 1024;
+size_t HttpBody::maxSize = 64 * 1024 * 1024;
+std::string HttpBody::tmpDir = "/tmp";
+
+HttpBody::HttpBody() : size_(0), fd_(-1) {}
+
+HttpBody::~HttpBody() {
+	Init();
+}
+
+void HttpBody::Init() {
+	if (fd_ >= 0) {
+		close(fd_);
+		fd_ = -1;
+	}
+	data_.clear();
+	size_ = 0;
+	handler_ = nullptr;
+}
+
+void HttpBody::Release() {
+	Init();
+	std::string().swap(data_);
+}
+
+void HttpBody::SetChunkHandler(ChunkHandler handler) {
+	handler_ = std::move(handler);
+}
+
+bool HttpBody::Append(const char *data, size_t len) {
+	if (len == 0) { return true; }
+	if (size_ + len > maxSize) {
+		LOG_WARN("Body too large: %zu > %zu", size_ + len, maxSize);
+		return false;
+	}
+	size_ += len;
+	if (handler_) {
+		return handler_(data, len);
+	}
+	if (fd_ < 0 && data_.size() + len > spillThreshold && !Spill_()) {
+		return false;
+	}
+	if (fd_ >= 0) {
+		return WriteFile_(data, len);
+	}
+	data_.append(data, len);
+	return true;
+}
+
+// 创建匿名临时文件，并把内存中已有的内容写进去
+bool HttpBody::Spill_() {
+	std::string path = tmpDir + "/webserver-body-XXXXXX";
+	fd_ = mkstemp(&path[0]);
+	if (fd_ < 0) {
+		LOG_ERROR("Create body spill file in %s error: %d", tmpDir.c_str(), errno);
+		return false;
+	}
+	unlink(path.c_str());
+	LOG_DEBUG("Body spilled to disk after %zu bytes", data_.size());
+	bool ok = WriteFile_(data_.data(), data_.size());
+	data_.clear();
+	return ok;
+}
+
+bool HttpBody::WriteFile_(const char *data, size_t len) {
+	while (len > 0) {
+		ssize_t n = write(fd_, data, len);
+		if (n < 0) {
+			if (errno == EINTR) { continue; }
+			LOG_ERROR("Write body spill file error: %d", errno);
+			return false;
+		}
+		data += n;
+		len -= n;
+	}
+	return true;
+}
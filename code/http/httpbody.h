@@ -0,0 +1,69 @@
+//
+// Created by moon on 25-3-20.
+//
+
+#ifndef HTTP_BODY_H
+#define HTTP_BODY_H
+
+#include <string>
+#include <functional>
+#include <unistd.h>      // write, close, unlink
+#include <errno.h>
+
+#include "../log/log.h"
+
+// 请求体存储
+// 请求体按到达顺序分块写入：设置了分块处理函数时直接交给处理函数（流式消费，不保存）；
+// 否则先放在内存里，超过 spillThreshold 后整体转存到已 unlink 的临时文件，
+// 读缓冲区和内存占用都不会随上传大小增长。
+class HttpBody {
+public:
+	// 分块处理函数：返回 false 表示拒绝该请求体（如超出业务限制）
+	typedef std::function<bool(const char *data, size_t len)> ChunkHandler;
+
+	HttpBody();
+
+	~HttpBody();
+
+	// 清空内容并关闭临时文件（保留内存容量供下个请求复用）
+	void Init();
+
+	// 清空内容并释放内存（连接空闲时使用）
+	void Release();
+
+	void SetChunkHandler(ChunkHandler handler);
+
+	// 追加一块请求体，超出 maxSize、处理函数拒绝或写盘失败时返回 false
+	bool Append(const char *data, size_t len);
+
+	// 已接收的请求体总字节数
+	size_t Size() const { return size_; }
+
+	bool IsSpilled() const { return fd_ >= 0; }
+
+	bool IsStreamed() const { return static_cast<bool>(handler_); }
+
+	// 内存中的请求体（未转存时为完整内容）
+	std::string &Data() { return data_; }
+
+	const std::string &Data() const { return data_; }
+
+	// 转存文件的描述符，未转存时为 -1
+	int Fd() const { return fd_; }
+
+	static size_t spillThreshold;   // 内存中保存的最大字节数
+	static size_t maxSize;          // 单个请求体的最大字节数
+	static std::string tmpDir;      // 转存文件所在目录
+
+private:
+	bool Spill_();
+
+	bool WriteFile_(const char *data, size_t len);
+
+	std::string data_;
+	size_t size_;
+	int fd_;
+	ChunkHandler handler_;
+};
+
+#endif //HTTP_BODY_H
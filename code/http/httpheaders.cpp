@@ -0,0 +1,136 @@
+//
+// Created by moon on 25-3-19.
+//
+
+#include "httpheaders.h"
+#include <strings.h>   // strncasecmp
+
+namespace {
+
+struct KnownName {
+	const char *name;
+	size_t len;
+};
+
+constexpr KnownName KNOWN_NAMES[HttpHeaders::KNOWN_COUNT] = {
+	{"Host", 4},
+	{"Connection", 10},
+	{"Content-Length", 14},
+	{"Content-Type", 12},
+	{"Transfer-Encoding", 17},
+	{"Accept-Encoding", 15},
+	{"If-None-Match", 13},
+	{"If-Modified-Since", 17},
+	{"If-Range", 8},
+	{"Range", 5},
+	{"User-Agent", 10},
+	{"Accept", 6},
+	{"Cookie", 6},
+	{"Referer", 7},
+	{"Origin", 6},
+	{"Expect", 6},
+	{"Keep-Alive", 10},
+	{"Upgrade", 7},
+};
+
+constexpr size_t TABLE_SIZE = 32;
+
+constexpr unsigned ToLower(char ch) {
+	return (ch >= 'A' && ch <= 'Z') ? static_cast<unsigned>(ch - 'A' + 'a') : static_cast<unsigned char>(ch);
+}
+
+// 只看长度和首尾字符，对上面的名字集合无冲突（由 static_assert 保证）
+constexpr size_t Hash(const char *name, size_t len) {
+	return (len * 2 + ToLower(name[0]) * 5 + ToLower(name[len - 1]) * 7) % TABLE_SIZE;
+}
+
+struct SlotTable {
+	signed char slot[TABLE_SIZE];
+};
+
+constexpr SlotTable BuildTable() {
+	SlotTable table{};
+	for (size_t i = 0; i < TABLE_SIZE; i++) { table.slot[i] = -1; }
+	for (int id = 0; id < HttpHeaders::KNOWN_COUNT; id++) {
+		table.slot[Hash(KNOWN_NAMES[id].name, KNOWN_NAMES[id].len)] = static_cast<signed char>(id);
+	}
+	return table;
+}
+
+constexpr bool IsPerfect() {
+	SlotTable table = BuildTable();
+	int used = 0;
+	for (size_t i = 0; i < TABLE_SIZE; i++) {
+		if (table.slot[i] >= 0) { used++; }
+	}
+	return used == HttpHeaders::KNOWN_COUNT;
+}
+
+static_assert(IsPerfect(), "known header hash has collisions, adjust Hash()");
+
+constexpr SlotTable SLOTS = BuildTable();
+
+} // namespace
+
+void HttpHeaders::Clear() {
+	present_ = 0;
+	extraCount_ = 0;
+}
+
+int HttpHeaders::Lookup(const char *name, size_t nameLen) {
+	if (nameLen == 0) { return -1; }
+	int id = SLOTS.slot[Hash(name, nameLen)];
+	if (id >= 0 && KNOWN_NAMES[id].len == nameLen && EqualsIgnoreCase_(KNOWN_NAMES[id].name, name, nameLen)) {
+		return id;
+	}
+	return -1;
+}
+
+const char *HttpHeaders::Name(Id id) {
+	return KNOWN_NAMES[id].name;
+}
+
+void HttpHeaders::Set(const char *name, size_t nameLen, const char *value, size_t valueLen) {
+	int id = Lookup(name, nameLen);
+	if (id >= 0) {
+		known_[id].assign(value, valueLen);
+		present_ |= (1u << id);
+		return;
+	}
+	for (size_t i = 0; i < extraCount_; i++) {
+		auto &item = extra_[i];
+		if (item.first.size() == nameLen && EqualsIgnoreCase_(item.first.data(), name, nameLen)) {
+			item.second.assign(value, valueLen);
+			return;
+		}
+	}
+	if (extraCount_ == extra_.size()) {
+		extra_.emplace_back();
+	}
+	extra_[extraCount_].first.assign(name, nameLen);
+	extra_[extraCount_].second.assign(value, valueLen);
+	extraCount_++;
+}
+
+const std::string &HttpHeaders::Get(Id id) const {
+	static const std::string EMPTY;
+	return Has(id) ? known_[id] : EMPTY;
+}
+
+const std::string *HttpHeaders::Find(const char *name, size_t nameLen) const {
+	int id = Lookup(name, nameLen);
+	if (id >= 0) {
+		return Has(static_cast<Id>(id)) ? &known_[id] : nullptr;
+	}
+	for (size_t i = 0; i < extraCount_; i++) {
+		const auto &item = extra_[i];
+		if (item.first.size() == nameLen && EqualsIgnoreCase_(item.first.data(), name, nameLen)) {
+			return &item.second;
+		}
+	}
+	return nullptr;
+}
+
+bool HttpHeaders::EqualsIgnoreCase_(const char *a, const char *b, size_t len) {
+	return strncasecmp(a, b, len) == 0;
+}
@@ -0,0 +1,73 @@
+//
+// Created by moon on 25-3-19.
+//
+
+#ifndef HTTP_HEADERS_H
+#define HTTP_HEADERS_H
+
+#include <string>
+#include <vector>
+#include <utility>
+#include <cstdint>
+
+// 请求头存储
+// 常用请求头经编译期完美哈希落到固定槽位，按枚举下标直接访问；
+// 其余请求头存入一个小的顺序表。Clear() 只重置计数，槽位字符串的容量
+// 在同一连接的多个请求间复用，稳定后解析请求头不再分配内存。
+class HttpHeaders {
+public:
+	enum Id {
+		HOST = 0,
+		CONNECTION,
+		CONTENT_LENGTH,
+		CONTENT_TYPE,
+		TRANSFER_ENCODING,
+		ACCEPT_ENCODING,
+		IF_NONE_MATCH,
+		IF_MODIFIED_SINCE,
+		IF_RANGE,
+		RANGE,
+		USER_AGENT,
+		ACCEPT,
+		COOKIE,
+		REFERER,
+		ORIGIN,
+		EXPECT,
+		KEEP_ALIVE,
+		UPGRADE,
+		KNOWN_COUNT,
+	};
+
+	HttpHeaders() : present_(0), extraCount_(0) {}
+
+	// 清空所有请求头（保留已分配的容量）
+	void Clear();
+
+	// 写入一个请求头，名字大小写不敏感；重复出现时后者覆盖前者
+	void Set(const char *name, size_t nameLen, const char *value, size_t valueLen);
+
+	bool Has(Id id) const { return present_ & (1u << id); }
+
+	// 常用请求头的值，不存在时返回空串
+	const std::string &Get(Id id) const;
+
+	// 按名字查找任意请求头，不存在时返回 nullptr
+	const std::string *Find(const char *name, size_t nameLen) const;
+
+	// 名字对应的常用请求头编号，非常用请求头返回 -1
+	static int Lookup(const char *name, size_t nameLen);
+
+	// 常用请求头的规范名字
+	static const char *Name(Id id);
+
+private:
+	static bool EqualsIgnoreCase_(const char *a, const char *b, size_t len);
+
+	uint32_t present_;                    // 第 i 位表示 known_[i] 已设置
+	std::string known_[KNOWN_COUNT];
+
+	size_t extraCount_;                   // extra_ 中有效的条目数
+	std::vector<std::pair<std::string, std::string> > extra_;
+};
+
+#endif //HTTP_HEADERS_H
@@ -6,83 +6,173 @@
 #include "httprequest.h"
 using namespace std;
 
-const unordered_set<string> HttpRequest::DEFAULT_HTML{
-            "/index", "/register", "/login",
-             "/welcome", "/video", "/picture", };
-
-const unordered_map<string, int> HttpRequest::DEFAULT_HTML_TAG {
-            {"/register.html", 0}, {"/login.html", 1},  };
+void HttpRequest::InitRoutes() {
+    static once_flag once;
+    call_once(once, []() {
+        Router* router = Router::Instance();
+        router->AddRewrite(Router::ANY, "/", "/index.html");
+        for(const char* page: { "/index", "/register", "/login", "/welcome", "/video", "/picture" }) {
+            router->AddRewrite(Router::ANY, page, string(page) + ".html");
+        }
+        /* 登录注册需要访问数据库 */
+        for(const char* page: { "/login", "/login.html" }) {
+            router->Add(Router::POST, page, Router::BLOCKING,
+                        [](HttpRequest& request, const Router::Params&) { UserHandler_(request, true); });
+        }
+        for(const char* page: { "/register", "/register.html" }) {
+            router->Add(Router::POST, page, Router::BLOCKING,
+                        [](HttpRequest& request, const Router::Params&) { UserHandler_(request, false); });
+        }
+    });
+}
 
 void HttpRequest::Init() {
-    method_ = path_ = version_ = body_ = "";
+    method_ = path_ = version_ = "";
     state_ = REQUEST_LINE;
-    header_.clear();
+    errCode_ = 400;
+    chunked_ = false;
+    chunkState_ = CHUNK_SIZE;
+    bodyLeft_ = 0;
+    isMultipart_ = false;
+    multipart_.Reset();
+    isJson_ = false;
+    json_.Clear();
+    arena_.Reset();
+    route_ = nullptr;
+    params_.count = 0;
+    handlerPending_ = false;
+    header_.Clear();
+    body_.Init();
     post_.clear();
 }
 
+void HttpRequest::Release() {
+    if(state_ != REQUEST_LINE && state_ != FINISH) { return; }
+    Init();
+    arena_.Release();
+    body_.Release();
+}
+
+bool HttpRequest::IsStaticRequest(const Buffer& buff) {
+    const char* begin = buff.GetReadPointer();
+    const char* end = buff.GetWriteConstPointer();
+    const char* lineEnd = Scanner::FindCRLF(begin, end);
+    if(lineEnd == end) { return false; }
+    const char* sp1 = Scanner::FindChar(begin, lineEnd, ' ');
+    size_t methodLen = sp1 - begin;
+    if(!(methodLen == 3 && memcmp(begin, "GET", 3) == 0) && !(methodLen == 4 && memcmp(begin, "HEAD", 4) == 0)) {
+        return false;
+    }
+    const char* sp2 = (sp1 == lineEnd) ? lineEnd : Scanner::FindChar(sp1 + 1, lineEnd, ' ');
+    if(sp2 == lineEnd) { return false; }
+
+    /* 请求头须已完整到达，且不声明请求体 */
+    const char* line = lineEnd + 2;
+    while(true) {
+        const char* next = Scanner::FindCRLF(line, end);
+        if(next == end) { return false; }
+        if(next == line) { break; }
+        size_t len = next - line;
+        if((len >= 15 && strncasecmp(line, "Content-Length:", 15) == 0)
+           || (len >= 18 && strncasecmp(line, "Transfer-Encoding:", 18) == 0)) {
+            return false;
+        }
+        line = next + 2;
+    }
+
+    static thread_local string method, path;
+    method.assign(begin, sp1);
+    path.assign(sp1 + 1, sp2);
+    Router::Params params;
+    const Router::Route* route = Router::Instance()->Match(method, path, &params);
+    return !route || !route->handler;
+}
+
 bool HttpRequest::IsKeepAlive() const {
-    if(header_.count("Connection") == 1) {
-        return header_.find("Connection")->second == "keep-alive" && version_ == "1.1";
+    if(header_.Has(HttpHeaders::CONNECTION)) {
+        return header_.Get(HttpHeaders::CONNECTION) == "keep-alive" && version_ == "1.1";
     }
     return false;
 }
 
 bool HttpRequest::parse(Buffer& buff) {
-    const char CRLF[] = "\r\n";
-    if(buff.GetReadableBytes() <= 0) {
-        return false;
-    }
     while(buff.GetReadableBytes() && state_ != FINISH) {
-        const char* lineEnd = search(buff.GetReadPointer(), buff.GetWriteConstPointer(), CRLF, CRLF + 2);
-        std::string line(buff.GetReadPointer(), lineEnd);
+        if(state_ == BODY) {
+            /* 请求体自行消费缓冲区，数据不足时留待下次读到后继续 */
+            if(!ParseBody_(buff)) { return false; }
+            if(state_ != FINISH) { break; }
+            continue;
+        }
+        const char* lineBegin = buff.GetReadPointer();
+        const char* lineEnd = Scanner::FindCRLF(lineBegin, buff.GetWriteConstPointer());
+        if(lineEnd == buff.GetWriteConstPointer()) {
+            /* 行不完整：等待更多数据，但不允许单行无限增长 */
+            if(buff.GetReadableBytes() > MAX_LINE_SIZE) {
+                LOG_ERROR("Request line too long");
+                errCode_ = 400;
+                return false;
+            }
+            break;
+        }
         switch(state_)
         {
         case REQUEST_LINE:
-            if(!ParseRequestLine_(line)) {
+            if(!ParseRequestLine_(lineBegin, lineEnd)) {
+                errCode_ = 400;
                 return false;
             }
             ParsePath_();
             break;    
         case HEADERS:
-            ParseHeader_(line);
-            if(buff.GetReadableBytes() <= 2) {
-                state_ = FINISH;
+            if(lineBegin == lineEnd) {
+                buff.ConsumeUntil(lineEnd + 2);
+                if(!ParseHeadersEnd_()) { return false; }
+                continue;
             }
-            break;
-        case BODY:
-            ParseBody_(line);
+            ParseHeader_(lineBegin, lineEnd);
             break;
         default:
             break;
         }
-        if(lineEnd == buff.GetWritePointer()) { break; }
         buff.ConsumeUntil(lineEnd + 2);
     }
-    LOG_DEBUG("[%s], [%s], [%s]", method_.c_str(), path_.c_str(), version_.c_str());
+    if(state_ == FINISH) {
+        LOG_DEBUG("[%s], [%s], [%s]", method_.c_str(), path_.c_str(), version_.c_str());
+    }
     return true;
 }
 
+bool HttpRequest::IsFinished() const {
+    return state_ == FINISH;
+}
+
+int HttpRequest::ErrorCode() const {
+    return errCode_;
+}
+
 void HttpRequest::ParsePath_() {
-    if(path_ == "/") {
-        path_ = "/index.html"; 
+    route_ = Router::Instance()->Match(method_, path_, &params_);
+    if(!route_) { return; }
+    /* 参数值指向 path_，改写前复制到请求级内存 */
+    for(size_t i = 0; i < params_.count; i++) {
+        Router::Param& param = params_.items[i];
+        param.value = arena_.CopyString(param.value, param.len);
     }
-    else {
-        for(auto &item: DEFAULT_HTML) {
-            if(item == path_) {
-                path_ += ".html";
-                break;
-            }
-        }
+    if(!route_->rewrite.empty()) {
+        path_ = route_->rewrite;
     }
 }
 
-bool HttpRequest::ParseRequestLine_(const string& line) {
-    regex patten("^([^ ]*) ([^ ]*) HTTP/([^ ]*)$");
-    smatch subMatch;
-    if(regex_match(line, subMatch, patten)) {   
-        method_ = subMatch[1];
-        path_ = subMatch[2];
-        version_ = subMatch[3];
+bool HttpRequest::ParseRequestLine_(const char* begin, const char* end) {
+    /* 等价于 ^([^ ]*) ([^ ]*) HTTP/([^ ]*)$ ，按空格切分 */
+    const char* sp1 = Scanner::FindChar(begin, end, ' ');
+    const char* sp2 = (sp1 == end) ? end : Scanner::FindChar(sp1 + 1, end, ' ');
+    const char* ver = sp2 + 1;
+    if(sp2 != end && end - ver >= 5 && memcmp(ver, "HTTP/", 5) == 0
+       && Scanner::FindChar(ver + 5, end, ' ') == end) {
+        method_.assign(begin, sp1);
+        path_.assign(sp1 + 1, sp2);
+        version_.assign(ver + 5, end);
         state_ = HEADERS;
         return true;
     }
@@ -90,22 +180,187 @@ bool HttpRequest::ParseRequestLine_(const string& line) {
     return false;
 }
 
-void HttpRequest::ParseHeader_(const string& line) {
-    regex patten("^([^:]*): ?(.*)$");
-    smatch subMatch;
-    if(regex_match(line, subMatch, patten)) {
-        header_[subMatch[1]] = subMatch[2];
+void HttpRequest::ParseHeader_(const char* begin, const char* end) {
+    /* 等价于 ^([^:]*): ?(.*)$ ，不含 ':' 的行忽略 */
+    const char* colon = Scanner::FindChar(begin, end, ':');
+    if(colon != end) {
+        const char* value = colon + 1;
+        if(value < end && *value == ' ') { value++; }
+        header_.Set(begin, colon - begin, value, end - value);
     }
-    else {
+}
+
+/* 请求头结束：根据 Transfer-Encoding / Content-Length 决定请求体的分帧方式 */
+bool HttpRequest::ParseHeadersEnd_() {
+    const string& encoding = header_.Get(HttpHeaders::TRANSFER_ENCODING);
+    if(encoding.find("chunked") != string::npos) {
+        chunked_ = true;
+        chunkState_ = CHUNK_SIZE;
         state_ = BODY;
     }
+    else if(header_.Has(HttpHeaders::CONTENT_LENGTH)) {
+        const string& length = header_.Get(HttpHeaders::CONTENT_LENGTH);
+        char* end = nullptr;
+        errno = 0;
+        unsigned long long len = strtoull(length.c_str(), &end, 10);
+        if(length.empty() || *end != '\0' || errno == ERANGE || length[0] == '-') {
+            LOG_ERROR("Bad Content-Length: %s", length.c_str());
+            errCode_ = 400;
+            return false;
+        }
+        if(len > HttpBody::maxSize) {
+            LOG_WARN("Content-Length %llu too large", len);
+            errCode_ = 413;
+            return false;
+        }
+        bodyLeft_ = len;
+        if(len > 0) { state_ = BODY; }
+        else { Finish_(); }
+    }
+    else {
+        Finish_();
+    }
+
+    /* 路由注册了分块处理函数：请求体原样交给它，此时尚未消费任何请求体字节 */
+    const string& type = header_.Get(HttpHeaders::CONTENT_TYPE);
+    if(state_ == BODY && route_ && route_->chunkHandler) {
+        body_.SetChunkHandler([this](const char* data, size_t len) {
+            return route_->chunkHandler(*this, params_, data, len);
+        });
+    }
+    /* 声明接收上传的路由：multipart 请求体边到达边解析，不经过 HttpBody 的内存/临时文件；
+       其他路由的 multipart 请求体与普通请求体一样处理，不会在上传目录留下文件 */
+    else if(state_ == BODY && route_ && route_->uploads && method_ == "POST"
+            && type.compare(0, 19, "multipart/form-data") == 0) {
+        if(!multipart_.Init(type)) {
+            errCode_ = 400;
+            return false;
+        }
+        isMultipart_ = true;
+        body_.SetChunkHandler([this](const char* data, size_t len) {
+            return multipart_.Feed(data, len);
+        });
+    }
+    else if(state_ == BODY && type.compare(0, 16, "application/json") == 0) {
+        isJson_ = true;
+    }
+    return true;
+}
+
+bool HttpRequest::ParseBody_(Buffer& buff) {
+    if(ParseBodyData_(buff)) { return true; }
+    /* 请求体被拒绝：已落盘的上传文件立即删除，不等到下个请求 */
+    if(isMultipart_) { multipart_.Reset(); }
+    return false;
 }
 
-void HttpRequest::ParseBody_(const string& line) {
-    body_ = line;
+/* 先检查请求体总大小，超限一律 413；其余失败由分块处理函数决定状态码 */
+bool HttpRequest::AppendBody_(const char* data, size_t len) {
+    if(body_.Size() + len > HttpBody::maxSize) {
+        LOG_WARN("Body too large: %zu > %zu", body_.Size() + len, HttpBody::maxSize);
+        errCode_ = 413;
+        return false;
+    }
+    if(!body_.Append(data, len)) {
+        errCode_ = isMultipart_ ? multipart_.ErrorCode() : 413;
+        return false;
+    }
+    return true;
+}
+
+bool HttpRequest::ParseBodyData_(Buffer& buff) {
+    if(!chunked_) {
+        size_t len = min(bodyLeft_, buff.GetReadableBytes());
+        if(!AppendBody_(buff.GetReadPointer(), len)) { return false; }
+        buff.ConsumeData(len);
+        bodyLeft_ -= len;
+        if(bodyLeft_ == 0) { return ParseBodyEnd_(); }
+        return true;
+    }
+
+    /* chunked：size CRLF data CRLF ... 0 CRLF [trailer CRLF] CRLF */
+    while(buff.GetReadableBytes()) {
+        if(chunkState_ == CHUNK_DATA) {
+            size_t len = min(bodyLeft_, buff.GetReadableBytes());
+            if(!AppendBody_(buff.GetReadPointer(), len)) { return false; }
+            buff.ConsumeData(len);
+            bodyLeft_ -= len;
+            if(bodyLeft_ == 0) { chunkState_ = CHUNK_DATA_END; }
+            continue;
+        }
+        const char* lineBegin = buff.GetReadPointer();
+        const char* lineEnd = Scanner::FindCRLF(lineBegin, buff.GetWriteConstPointer());
+        if(lineEnd == buff.GetWriteConstPointer()) {
+            if(buff.GetReadableBytes() > MAX_LINE_SIZE) {
+                errCode_ = 400;
+                return false;
+            }
+            return true;
+        }
+        switch(chunkState_) {
+        case CHUNK_SIZE: {
+            /* 块大小为十六进制，';' 之后的块扩展忽略 */
+            char* end = nullptr;
+            errno = 0;
+            unsigned long long len = strtoull(lineBegin, &end, 16);
+            if(end == lineBegin || errno == ERANGE || (end != lineEnd && *end != ';' && *end != ' ')) {
+                LOG_ERROR("Bad chunk size");
+                errCode_ = 400;
+                return false;
+            }
+            if(len > HttpBody::maxSize) {
+                errCode_ = 413;
+                return false;
+            }
+            bodyLeft_ = len;
+            chunkState_ = (len > 0) ? CHUNK_DATA : CHUNK_TRAILER;
+            break;
+        }
+        case CHUNK_DATA_END:
+            if(lineBegin != lineEnd) {
+                LOG_ERROR("Bad chunk end");
+                errCode_ = 400;
+                return false;
+            }
+            chunkState_ = CHUNK_SIZE;
+            break;
+        case CHUNK_TRAILER:
+            if(lineBegin == lineEnd) {
+                buff.ConsumeUntil(lineEnd + 2);
+                return ParseBodyEnd_();
+            }
+            break;
+        default:
+            break;
+        }
+        buff.ConsumeUntil(lineEnd + 2);
+    }
+    return true;
+}
+
+bool HttpRequest::ParseBodyEnd_() {
+    LOG_DEBUG("Body len:%zu, spilled:%d", body_.Size(), body_.IsSpilled());
+    if(isMultipart_) {
+        if(!multipart_.IsFinished()) {
+            LOG_ERROR("Multipart body truncated");
+            multipart_.Reset();
+            errCode_ = 400;
+            return false;
+        }
+        ParseFormData_();
+    }
+    if(isJson_ && !ParseJson_()) {
+        return false;
+    }
     ParsePost_();
+    Finish_();
+    return true;
+}
+
+/* 请求完整（含没有请求体的请求）：命中带处理函数的路由时等待 RunHandler */
+void HttpRequest::Finish_() {
     state_ = FINISH;
-    LOG_DEBUG("Body:%s, len:%d", line.c_str(), line.size());
+    handlerPending_ = route_ && route_->handler;
 }
 
 int HttpRequest::ConverHex(char ch) {
@@ -115,50 +370,59 @@ int HttpRequest::ConverHex(char ch) {
 }
 
 void HttpRequest::ParsePost_() {
-    if(method_ == "POST" && header_["Content-Type"] == "application/x-www-form-urlencoded") {
+    if(method_ == "POST" && header_.Get(HttpHeaders::CONTENT_TYPE) == "application/x-www-form-urlencoded") {
         ParseFromUrlencoded_();
-        if(DEFAULT_HTML_TAG.count(path_)) {
-            int tag = DEFAULT_HTML_TAG.find(path_)->second;
-            LOG_DEBUG("Tag:%d", tag);
-            if(tag == 0 || tag == 1) {
-                bool isLogin = (tag == 1);
-                if(UserVerify(post_["username"], post_["password"], isLogin)) {
-                    path_ = "/welcome.html";
-                } 
-                else {
-                    path_ = "/error.html";
-                }
-            }
-        }
-    }   
+    }
+    /* JSON 与 multipart 的表单字段已在解析请求体时并入 post_ */
+}
+
+void HttpRequest::RunHandler() {
+    if(!handlerPending_) { return; }
+    handlerPending_ = false;
+    route_->handler(*this, params_);
+}
+
+void HttpRequest::UserHandler_(HttpRequest& request, bool isLogin) {
+    LOG_DEBUG("User %s", isLogin ? "login" : "register");
+    if(UserVerify(request.post_["username"], request.post_["password"], isLogin)) {
+        request.path_ = "/welcome.html";
+    } 
+    else {
+        request.path_ = "/error.html";
+    }
 }
 
 void HttpRequest::ParseFromUrlencoded_() {
-    if(body_.size() == 0) { return; }
+    if(body_.IsSpilled()) {
+        LOG_WARN("Urlencoded body too large, ignored");
+        return;
+    }
+    string& body = body_.Data();
+    if(body.size() == 0) { return; }
 
     string key, value;
     int num = 0;
-    int n = body_.size();
+    int n = body.size();
     int i = 0, j = 0;
 
     for(; i < n; i++) {
-        char ch = body_[i];
+        char ch = body[i];
         switch (ch) {
         case '=':
-            key = body_.substr(j, i - j);
+            key = body.substr(j, i - j);
             j = i + 1;
             break;
         case '+':
-            body_[i] = ' ';
+            body[i] = ' ';
             break;
         case '%':
-            num = ConverHex(body_[i + 1]) * 16 + ConverHex(body_[i + 2]);
-            body_[i + 2] = num % 10 + '0';
-            body_[i + 1] = num / 10 + '0';
+            num = ConverHex(body[i + 1]) * 16 + ConverHex(body[i + 2]);
+            body[i + 2] = num % 10 + '0';
+            body[i + 1] = num / 10 + '0';
             i += 2;
             break;
         case '&':
-            value = body_.substr(j, i - j);
+            value = body.substr(j, i - j);
             j = i + 1;
             post_[key] = value;
             LOG_DEBUG("%s = %s", key.c_str(), value.c_str());
@@ -169,25 +433,63 @@ void HttpRequest::ParseFromUrlencoded_() {
     }
     assert(j <= i);
     if(post_.count(key) == 0 && j < i) {
-        value = body_.substr(j, i - j);
+        value = body.substr(j, i - j);
         post_[key] = value;
     }
 }
 
+/* JSON 请求体在内存中建立结构索引；顶层的标量成员并入 post_，与表单共用 GetPost */
+bool HttpRequest::ParseJson_() {
+    if(body_.IsSpilled()) {
+        LOG_WARN("Json body too large: %zu", body_.Size());
+        errCode_ = 413;
+        return false;
+    }
+    const string& body = body_.Data();
+    if(!json_.Parse(body.data(), body.size(), &arena_)) {
+        LOG_ERROR("Json body error");
+        errCode_ = 400;
+        return false;
+    }
+    json_.Root().ForEachMember([this](JsonString key, JsonValue value) {
+        JsonValue::Type type = value.GetType();
+        if(type != JsonValue::OBJECT && type != JsonValue::ARRAY) {
+            post_[string(key.data, key.size)] = value.AsString();
+        }
+    });
+    return true;
+}
+
+/* 普通字段并入 post_，文件 part 通过 GetUploads 获取 */
+void HttpRequest::ParseFormData_() {
+    for(const auto& part: multipart_.Parts()) {
+        if(part.filename.empty() && !part.name.empty()) {
+            post_[part.name] = part.value;
+        }
+        else if(!part.filename.empty()) {
+            LOG_INFO("Upload %s(%zu bytes) saved to %s", part.filename.c_str(), part.size, part.path.c_str());
+        }
+    }
+}
+
 bool HttpRequest::UserVerify(const string &name, const string &pwd, bool isLogin) {
     if(name == "" || pwd == "") { return false; }
     LOG_INFO("Verify name:%s pwd:%s", name.c_str(), pwd.c_str());
+    /* 注册行为：交给写线程组提交，批量 INSERT */
+    if(!isLogin) {
+        bool flag = SqlBatchWriter::Instance()->Register(name, pwd);
+        LOG_DEBUG("register %s!", flag ? "success" : "failed");
+        return flag;
+    }
+
     MYSQL* sql;
-    SqlConnRAII(&sql,  SqlConnPool::Instance());
-    assert(sql);
+    SqlConnRAII conn(&sql, SqlConnPool::Instance());   /* 函数返回时归还连接 */
+    if(!sql) { return false; }
     
     bool flag = false;
-    unsigned int j = 0;
     char order[256] = { 0 };
-    MYSQL_FIELD *fields = nullptr;
     MYSQL_RES *res = nullptr;
     
-    if(!isLogin) { flag = true; }
     /* 查询用户及密码 */
     snprintf(order, 256, "SELECT username, password FROM user WHERE username='%s' LIMIT 1", name.c_str());
     LOG_DEBUG("%s", order);
@@ -197,40 +499,17 @@ bool HttpRequest::UserVerify(const string &name, const string &pwd, bool isLogin
         return false; 
     }
     res = mysql_store_result(sql);
-    j = mysql_num_fields(res);
-    fields = mysql_fetch_fields(res);
 
     while(MYSQL_ROW row = mysql_fetch_row(res)) {
         LOG_DEBUG("MYSQL ROW: %s %s", row[0], row[1]);
         string password(row[1]);
-        /* 注册行为 且 用户名未被使用*/
-        if(isLogin) {
-            if(pwd == password) { flag = true; }
-            else {
-                flag = false;
-                LOG_DEBUG("pwd error!");
-            }
-        } 
-        else { 
-            flag = false; 
-            LOG_DEBUG("user used!");
+        if(pwd == password) { flag = true; }
+        else {
+            flag = false;
+            LOG_DEBUG("pwd error!");
         }
     }
     mysql_free_result(res);
-
-    /* 注册行为 且 用户名未被使用*/
-    if(!isLogin && flag == true) {
-        LOG_DEBUG("regirster!");
-        bzero(order, 256);
-        snprintf(order, 256,"INSERT INTO user(username, password) VALUES('%s','%s')", name.c_str(), pwd.c_str());
-        LOG_DEBUG( "%s", order);
-        if(mysql_query(sql, order)) { 
-            LOG_DEBUG( "Insert error!");
-            flag = false; 
-        }
-        flag = true;
-    }
-    SqlConnPool::Instance()->FreeConn(sql);
     LOG_DEBUG( "UserVerify success!!");
     return flag;
 }
@@ -250,6 +529,26 @@ std::string HttpRequest::version() const {
     return version_;
 }
 
+const HttpHeaders& HttpRequest::headers() const {
+    return header_;
+}
+
+const HttpBody& HttpRequest::body() const {
+    return body_;
+}
+
+const std::vector<MultipartParser::Part>& HttpRequest::GetUploads() const {
+    return multipart_.Parts();
+}
+
+std::string HttpRequest::TakeUpload(size_t index) {
+    return multipart_.TakeFile(index);
+}
+
+JsonValue HttpRequest::GetJson() const {
+    return isJson_ ? json_.Root() : JsonValue();
+}
+
 std::string HttpRequest::GetPost(const std::string& key) const {
     assert(key != "");
     if(post_.count(key) == 1) {
@@ -264,4 +563,17 @@ std::string HttpRequest::GetPost(const char* key) const {
         return post_.find(key)->second;
     }
     return "";
+}
+
+std::string HttpRequest::GetParam(const char* name) const {
+    assert(name != nullptr);
+    const Router::Param* param = params_.Find(name);
+    if(param) {
+        return std::string(param->value, param->len);
+    }
+    return "";
+}
+
+const Router::Route* HttpRequest::route() const {
+    return route_;
 }
\ No newline at end of file
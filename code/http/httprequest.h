@@ -9,14 +9,22 @@
 #include <unordered_map>
 #include <unordered_set>
 #include <string>
-#include <regex>
+#include <mutex>
 #include <errno.h>     
 #include <mysql/mysql.h>  //mysql
 
 #include "../buffer/buffer.h"
+#include "scanner.h"
+#include "httpheaders.h"
+#include "httpbody.h"
+#include "multipart.h"
+#include "json.h"
+#include "router.h"
+#include "../buffer/arena.h"
 #include "../log/log.h"
 #include "../pool/sqlconnpool.h"
 #include "../pool/sqlconnRAII.h"
+#include "../pool/sqlbatchwriter.h"
 
 class HttpRequest {
 public:
@@ -27,6 +35,13 @@ public:
         FINISH,        
     };
 
+    enum CHUNK_STATE {
+        CHUNK_SIZE,
+        CHUNK_DATA,
+        CHUNK_DATA_END,
+        CHUNK_TRAILER,
+    };
+
     enum HTTP_CODE {
         NO_REQUEST = 0,
         GET_REQUEST,
@@ -42,41 +57,90 @@ public:
     ~HttpRequest() = default;
 
     void Init();
+
+    /* 没有进行中的请求时释放请求级内存，连接空闲期间不占用 */
+    void Release();
+    /* 增量解析：可多次调用，返回 false 表示请求非法（见 ErrorCode） */
     bool parse(Buffer& buff);
+    bool IsFinished() const;
+    /* 尚未开始解析新请求（没有解析到一半的请求行、请求头或请求体） */
+    bool IsIdle() const { return state_ == REQUEST_LINE; }
+    int ErrorCode() const;
 
     std::string path() const;
     std::string& path();
     std::string method() const;
     std::string version() const;
+    const HttpHeaders& headers() const;
+    const HttpBody& body() const;
     std::string GetPost(const std::string& key) const;
     std::string GetPost(const char* key) const;
+    /* 路由中的路径参数，如 /user/:id 的 id */
+    std::string GetParam(const char* name) const;
+    /* 命中的路由，未命中为 nullptr */
+    const Router::Route* route() const;
+
+    /* 请求体解析完成后，路由的处理函数尚未执行；由调用者按 HandlerType 选择线程后 RunHandler */
+    bool HandlerPending() const { return handlerPending_; }
+    Router::HandlerType HandlerType() const { return route_ ? route_->type : Router::STATIC; }
+    void RunHandler();
 
     bool IsKeepAlive() const;
 
-    /* 
-    todo 
-    void HttpConn::ParseFormData() {}
-    void HttpConn::ParseJson() {}
-    */
+    /* multipart/form-data 中的文件及字段，只有 Router::AddUpload 注册的路由才会解析 */
+    const std::vector<MultipartParser::Part>& GetUploads() const;
+    /* 处理函数取走第 index 个上传文件的所有权（返回其路径），未取走的文件在请求结束时删除 */
+    std::string TakeUpload(size_t index);
+    /* application/json 请求体的根节点，非 JSON 请求返回无效值 */
+    JsonValue GetJson() const;
+
+    /* 注册内置路由（页面改写、登录注册），启动时调用一次 */
+    static void InitRoutes();
+
+    /* 只查看不消费：缓冲区开头是否为完整的、不带请求体的 GET/HEAD 请求，
+       且命中的路由没有处理函数（即只读静态资源），供 Reactor 判断能否内联处理 */
+    static bool IsStaticRequest(const Buffer& buff);
 
 private:
-    bool ParseRequestLine_(const std::string& line);
-    void ParseHeader_(const std::string& line);
-    void ParseBody_(const std::string& line);
+    bool ParseRequestLine_(const char* begin, const char* end);
+    void ParseHeader_(const char* begin, const char* end);
+    bool ParseHeadersEnd_();
+    bool ParseBody_(Buffer& buff);
+    bool ParseBodyData_(Buffer& buff);
+    bool AppendBody_(const char* data, size_t len);
+    bool ParseBodyEnd_();
+    void Finish_();
 
     void ParsePath_();
     void ParsePost_();
     void ParseFromUrlencoded_();
+    void ParseFormData_();
+    bool ParseJson_();
 
     static bool UserVerify(const std::string& name, const std::string& pwd, bool isLogin);
+    static void UserHandler_(HttpRequest& request, bool isLogin);
 
     PARSE_STATE state_;
-    std::string method_, path_, version_, body_;
-    std::unordered_map<std::string, std::string> header_;
+    int errCode_;
+    std::string method_, path_, version_;
+    HttpHeaders header_;
+
+    HttpBody body_;
+    bool chunked_;
+    CHUNK_STATE chunkState_;
+    size_t bodyLeft_;   /* 当前（块）剩余的请求体字节数 */
+    bool isMultipart_;
+    MultipartParser multipart_;
+    bool isJson_;
+    JsonDoc json_;
+    Arena arena_;       /* 请求级内存，Init 时整体回收 */
+    const Router::Route* route_;
+    Router::Params params_;   /* 参数值已复制到 arena_ */
+    bool handlerPending_;
+
+    static const size_t MAX_LINE_SIZE = 8192;
     std::unordered_map<std::string, std::string> post_;
 
-    static const std::unordered_set<std::string> DEFAULT_HTML;
-    static const std::unordered_map<std::string, int> DEFAULT_HTML_TAG;
     static int ConverHex(char ch);
 };
 
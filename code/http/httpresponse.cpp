@@ -4,36 +4,59 @@
  * @copyleft Apache 2.0
  */ 
 #include "httpresponse.h"
+#include "httprequest.h"
+#include <algorithm>
+#include <random>
+#include <strings.h>    // strncasecmp
 
 using namespace std;
 
 const unordered_map<string, string> HttpResponse::SUFFIX_TYPE = {
-    { ".html",  "text/html" },
-    { ".xml",   "text/xml" },
+    { ".html",  "text/html; charset=utf-8" },
+    { ".htm",   "text/html; charset=utf-8" },
+    { ".xml",   "text/xml; charset=utf-8" },
     { ".xhtml", "application/xhtml+xml" },
-    { ".txt",   "text/plain" },
+    { ".txt",   "text/plain; charset=utf-8" },
     { ".rtf",   "application/rtf" },
     { ".pdf",   "application/pdf" },
-    { ".word",  "application/nsword" },
+    { ".word",  "application/msword" },
+    { ".json",  "application/json" },
     { ".png",   "image/png" },
     { ".gif",   "image/gif" },
     { ".jpg",   "image/jpeg" },
     { ".jpeg",  "image/jpeg" },
+    { ".webp",  "image/webp" },
+    { ".svg",   "image/svg+xml" },
+    { ".ico",   "image/x-icon" },
+    { ".woff",  "font/woff" },
+    { ".woff2", "font/woff2" },
+    { ".ttf",   "font/ttf" },
+    { ".otf",   "font/otf" },
+    { ".eot",   "application/vnd.ms-fontobject" },
     { ".au",    "audio/basic" },
+    { ".mp3",   "audio/mpeg" },
     { ".mpeg",  "video/mpeg" },
     { ".mpg",   "video/mpeg" },
+    { ".mp4",   "video/mp4" },
+    { ".webm",  "video/webm" },
     { ".avi",   "video/x-msvideo" },
     { ".gz",    "application/x-gzip" },
     { ".tar",   "application/x-tar" },
-    { ".css",   "text/css "},
-    { ".js",    "text/javascript "},
+    { ".css",   "text/css; charset=utf-8" },
+    { ".js",    "text/javascript; charset=utf-8" },
 };
 
 const unordered_map<int, string> HttpResponse::CODE_STATUS = {
     { 200, "OK" },
+    { 206, "Partial Content" },
+    { 304, "Not Modified" },
     { 400, "Bad Request" },
     { 403, "Forbidden" },
     { 404, "Not Found" },
+    { 413, "Payload Too Large" },
+    { 416, "Range Not Satisfiable" },
+    { 500, "Internal Server Error" },
+    { 503, "Service Unavailable" },
 };
 
 const unordered_map<int, string> HttpResponse::CODE_PATH = {
@@ -42,10 +65,46 @@ const unordered_map<int, string> HttpResponse::CODE_PATH = {
     { 404, "/404.html" },
 };
 
+/* 默认缓存策略：页面每次协商，样式脚本缓存一天，图片字体和媒体缓存一周 */
+unordered_map<string, int> HttpResponse::CACHE_MAX_AGE = {
+    { ".html",  0 },
+    { ".css",   86400 },
+    { ".js",    86400 },
+    { ".png",   604800 },
+    { ".gif",   604800 },
+    { ".jpg",   604800 },
+    { ".jpeg",  604800 },
+    { ".ico",   604800 },
+    { ".svg",   604800 },
+    { ".woff",  604800 },
+    { ".woff2", 604800 },
+    { ".ttf",   604800 },
+    { ".otf",   604800 },
+    { ".eot",   604800 },
+    { ".mp4",   604800 },
+    { ".webm",  604800 },
+};
+
+/* 文本类资源才值得压缩，图片、视频等本身已是压缩格式 */
+const unordered_set<string> HttpResponse::COMPRESS_SUFFIX = {
+    ".html", ".xhtml", ".xml", ".txt", ".css", ".js", ".json", ".svg", ".rtf",
+};
+
+std::atomic<bool> HttpResponse::cacheConfigLocked_(false);
+
+size_t HttpResponse::minCompressSize = 256;
+size_t HttpResponse::inlineThreshold = 16 * 1024;
+int HttpResponse::keepAliveTimeout = 0;
+const char* HttpResponse::serverName = "TinyWebServer";
+
 HttpResponse::HttpResponse() {
     code_ = -1;
+    request_ = nullptr;
+    image_ = nullptr;
     path_ = srcDir_ = "";
     isKeepAlive_ = false;
+    noBlock_ = false;
+    wouldBlock_ = false;
     mmFile_ = nullptr; 
     mmFileStat_ = { 0 };
 };
@@ -54,32 +113,67 @@ HttpResponse::~HttpResponse() {
     UnmapFile();
 }
 
-void HttpResponse::Init(const string& srcDir, string& path, bool isKeepAlive, int code){
-    assert(srcDir != "");
+void HttpResponse::Init(const char* srcDir, const string& path, bool isKeepAlive, int code,
+                        const HttpRequest* request){
+    assert(srcDir && *srcDir);
     if(mmFile_) { UnmapFile(); }
     code_ = code;
+    request_ = request;
     isKeepAlive_ = isKeepAlive;
+    noBlock_ = false;
+    wouldBlock_ = false;
     path_ = path;
     srcDir_ = srcDir;
     mmFile_ = nullptr; 
     mmFileStat_ = { 0 };
+    ranges_.clear();
+    body_.clear();
+    encoding_.clear();
+    sidecar_.clear();
+    encoded_.reset();
+    content_.reset();
+    image_ = nullptr;
 }
 
-void HttpResponse::MakeResponse(Buffer& buff) {
-    /* 判断请求的资源文件 */
-    if(stat((srcDir_ + path_).data(), &mmFileStat_) < 0 || S_ISDIR(mmFileStat_.st_mode)) {
+bool HttpResponse::MakeResponse(ChainBuffer& buff) {
+    /* 判断请求的资源文件（解析阶段已确定的错误码直接使用） */
+    if(code_ >= 400) {
+        mmFileStat_ = { 0 };
+    }
+    else if(FromImage_()) {
+        /* 资源镜像命中，不访问文件系统 */
+    }
+    else if(!FileCache::Instance()->Lookup(FullPath_(), &fileInfo_) || S_ISDIR(fileInfo_.st.st_mode)) {
         code_ = 404;
     }
-    else if(!(mmFileStat_.st_mode & S_IROTH)) {
+    else if(!(fileInfo_.st.st_mode & S_IROTH)) {
         code_ = 403;
     }
-    else if(code_ == -1) { 
-        code_ = 200; 
+    else {
+        mmFileStat_ = fileInfo_.st;
+        if(code_ == -1) { code_ = 200; }
+        if(code_ == 200) { SelectEncoding_(); }
+        if(code_ == 200 && IsNotModified_()) { code_ = 304; }
+        if(code_ == 200) { ParseRange_(); }
     }
     ErrorHtml_();
+    if(WouldBlock_()) { return false; }
     AddStateLine_(buff);
     AddHeader_(buff);
     AddContent_(buff);
+    InlineBody_(buff);
+    return true;
+}
+
+/* 不可阻塞模式下，响应体须已在内存中：小文件取缓存的内容，大文件需映射后发送（可能缺页），都交给工作线程 */
+bool HttpResponse::WouldBlock_() {
+    if(!noBlock_ || wouldBlock_) { return wouldBlock_; }
+    if(image_ || encoded_ || code_ == 304 || (code_ >= 400 && CODE_PATH.count(code_) == 0)) { return false; }
+    if(static_cast<size_t>(mmFileStat_.st_size) <= inlineThreshold) {
+        content_ = FileCache::Instance()->CachedContent(FilePath(), mmFileStat_);
+    }
+    wouldBlock_ = !content_;
+    return wouldBlock_;
 }
 
 char* HttpResponse::File() {
@@ -93,35 +187,169 @@ size_t HttpResponse::FileLen() const {
 void HttpResponse::ErrorHtml_() {
     if(CODE_PATH.count(code_) == 1) {
         path_ = CODE_PATH.find(code_)->second;
-        stat((srcDir_ + path_).data(), &mmFileStat_);
+        const ResourceImage::Entry* entry = ResourceImage::Instance()->Find(path_);
+        if(entry) {
+            image_ = &entry->variants[ResourceImage::IDENTITY];
+            mmFileStat_.st_size = image_->body.len;
+            return;
+        }
+        image_ = nullptr;
+        if(FileCache::Instance()->Lookup(FullPath_(), &fileInfo_)) {
+            mmFileStat_ = fileInfo_.st;
+        }
     }
 }
 
-void HttpResponse::AddStateLine_(Buffer& buff) {
-    string status;
-    if(CODE_STATUS.count(code_) == 1) {
-        status = CODE_STATUS.find(code_)->second;
+/* 在资源镜像中查找，命中时按与文件系统相同的规则处理协商、条件请求和区间 */
+bool HttpResponse::FromImage_() {
+    const ResourceImage::Entry* entry = ResourceImage::Instance()->Find(path_);
+    if(!entry) { return false; }
+    image_ = &entry->variants[ResourceImage::IDENTITY];
+    if(code_ == -1) { code_ = 200; }
+    const ResourceImage::Variant& gzip = entry->variants[ResourceImage::GZIP];
+    if(code_ == 200 && gzip.body.len > 0 && request_
+       && EncodingQuality_(request_->headers().Get(HttpHeaders::ACCEPT_ENCODING), "gzip") > 0) {
+        image_ = &gzip;
+        encoding_ = "gzip";
     }
-    else {
+    const ResourceImage* image = ResourceImage::Instance();
+    fileInfo_.etag.assign(image->Data(image_->etag), image_->etag.len);
+    fileInfo_.st.st_mtime = entry->mtime;
+    mmFileStat_.st_size = image_->body.len;
+    if(code_ == 200 && IsNotModified_()) { code_ = 304; }
+    if(code_ == 200) { ParseRange_(); }
+    return true;
+}
+
+void HttpResponse::AddStateLine_(ChainBuffer& buff) {
+    auto it = CODE_STATUS.find(code_);
+    if(it == CODE_STATUS.end()) {
         code_ = 400;
-        status = CODE_STATUS.find(400)->second;
+        it = CODE_STATUS.find(400);
     }
-    buff.Append("HTTP/1.1 " + to_string(code_) + " " + status + "\r\n");
+    buff.Append("HTTP/1.1 ", 9);
+    AppendNumber_(buff, code_);
+    buff.Append(" ", 1);
+    buff.Append(it->second);
+    buff.Append("\r\n", 2);
+}
+
+void HttpResponse::AppendNumber_(ChainBuffer& buff, long long num) {
+    char digits[24];
+    int n = snprintf(digits, sizeof(digits), "%lld", num);
+    buff.Append(digits, n);
 }
 
-void HttpResponse::AddHeader_(Buffer& buff) {
-    buff.Append("Connection: ");
+const string& HttpResponse::FullPath_(const char* suffix) {
+    filePath_.assign(srcDir_).append(path_).append(suffix);
+    return filePath_;
+}
+
+void HttpResponse::AddHeader_(ChainBuffer& buff) {
+    buff.Append(DateHeader_());
+    buff.Append("Server: ");
+    buff.Append(serverName);
+    buff.Append("\r\nConnection: ");
     if(isKeepAlive_) {
         buff.Append("keep-alive\r\n");
-        buff.Append("keep-alive: max=6, timeout=120\r\n");
+        if(keepAliveTimeout > 0) {
+            buff.Append("Keep-Alive: timeout=");
+            AppendNumber_(buff, keepAliveTimeout);
+            buff.Append("\r\n", 2);
+        }
     } else{
         buff.Append("close\r\n");
     }
-    buff.Append("Content-type: " + GetFileType_() + "\r\n");
+    if(code_ == 200 || code_ == 206 || code_ == 304) {
+        /* 缓存校验信息 */
+        if(image_) {
+            buff.Append(ResourceImage::Instance()->Data(image_->headers), image_->headers.len);
+        } else {
+            headerScratch_.clear();
+            AppendCacheHeaders(fileInfo_, GetSuffix_(), &headerScratch_);
+            buff.Append(headerScratch_);
+        }
+    }
+    if(code_ == 304) { return; }
+    if(code_ == 200 || code_ == 206) {
+        buff.Append("Accept-Ranges: bytes\r\n");
+        if(!encoding_.empty()) {
+            buff.Append("Content-Encoding: ");
+            buff.Append(encoding_);
+            buff.Append("\r\n", 2);
+        }
+    }
+    if(code_ == 416) {
+        buff.Append("Content-Range: bytes */");
+        AppendNumber_(buff, mmFileStat_.st_size);
+        buff.Append("\r\n", 2);
+    }
+    if(code_ == 206 && ranges_.size() > 1) {
+        buff.Append("Content-Type: multipart/byteranges; boundary=");
+        buff.Append(boundary_);
+        buff.Append("\r\n", 2);
+        return;
+    }
+    if(code_ == 206) {
+        buff.Append("Content-Range: bytes ");
+        AppendNumber_(buff, ranges_[0].first);
+        buff.Append("-", 1);
+        AppendNumber_(buff, ranges_[0].second);
+        buff.Append("/", 1);
+        AppendNumber_(buff, mmFileStat_.st_size);
+        buff.Append("\r\n", 2);
+    }
+    if(code_ >= 400 && CODE_PATH.count(code_) == 0) {
+        buff.Append("Content-Type: text/html; charset=utf-8\r\n");   /* ErrorContent 生成的页面 */
+        return;
+    }
+    buff.Append("Content-Type: ");
+    buff.Append(GetFileType_());
+    buff.Append("\r\n", 2);
 }
 
-void HttpResponse::AddContent_(Buffer& buff) {
-    int srcFd = open((srcDir_ + path_).data(), O_RDONLY);
+/* Date 头按秒缓存，每个线程每秒只格式化一次 */
+const string& HttpResponse::DateHeader_() {
+    static thread_local time_t last = 0;
+    static thread_local string header;
+    time_t now = time(nullptr);
+    if(now != last) {
+        char buf[32];
+        FileCache::FormatHttpDate(now, buf);
+        header.assign("Date: ").append(buf).append("\r\n");
+        last = now;
+    }
+    return header;
+}
+
+void HttpResponse::AddContent_(ChainBuffer& buff) {
+    if(code_ == 304) {
+        /* 304 不带响应体 */
+        buff.Append("\r\n");
+        return;
+    }
+    if(code_ >= 400 && CODE_PATH.count(code_) == 0) {
+        ErrorContent(buff, CODE_STATUS.find(code_)->second);
+        return;
+    }
+    if(image_) {
+        AddBody_(buff, const_cast<char*>(ResourceImage::Instance()->Data(image_->body)));
+        return;
+    }
+    if(encoded_) {
+        /* 已缓存的压缩结果，直接引用 */
+        AddBody_(buff, const_cast<char*>(encoded_->data()));
+        return;
+    }
+    if(!content_ && static_cast<size_t>(mmFileStat_.st_size) <= inlineThreshold) {
+        /* 小文件从文件缓存取内容，不打开也不映射 */
+        content_ = FileCache::Instance()->Content(FilePath(), mmFileStat_);
+    }
+    if(content_) {
+        AddBody_(buff, const_cast<char*>(content_->data()));
+        return;
+    }
+    int srcFd = open(FilePath().c_str(), O_RDONLY);
     if(srcFd < 0) { 
         ErrorContent(buff, "File NotFound!");
         return; 
@@ -129,15 +357,77 @@ void HttpResponse::AddContent_(Buffer& buff) {
 
     /* 将文件映射到内存提高文件的访问速度 
         MAP_PRIVATE 建立一个写入时拷贝的私有映射*/
-    LOG_DEBUG("file path %s", (srcDir_ + path_).data());
-    int* mmRet = (int*)mmap(0, mmFileStat_.st_size, PROT_READ, MAP_PRIVATE, srcFd, 0);
-    if(*mmRet == -1) {
+    LOG_DEBUG("file path %s", filePath_.c_str());
+    if(mmFileStat_.st_size == 0) {
+        /* 空文件无法映射，直接返回空响应体 */
+        close(srcFd);
+        buff.Append("Content-Length: 0\r\n\r\n");
+        return;
+    }
+    void* mmRet = mmap(0, mmFileStat_.st_size, PROT_READ, MAP_PRIVATE, srcFd, 0);
+    close(srcFd);
+    if(mmRet == MAP_FAILED) {
         ErrorContent(buff, "File NotFound!");
         return; 
     }
     mmFile_ = (char*)mmRet;
-    close(srcFd);
-    buff.Append("Content-length: " + to_string(mmFileStat_.st_size) + "\r\n\r\n");
+    AddBody_(buff, mmFile_);
+}
+
+/* 按状态码组织响应体片段，区间直接指向映射内存（或压缩缓存）中的偏移，不做拷贝 */
+void HttpResponse::AddBody_(ChainBuffer& buff, char* content) {
+    if(code_ != 206) {
+        body_.push_back({ content, static_cast<size_t>(mmFileStat_.st_size) });
+        buff.Append("Content-Length: ");
+        AppendNumber_(buff, mmFileStat_.st_size);
+        buff.Append("\r\n\r\n", 4);
+        return;
+    }
+    if(ranges_.size() == 1) {
+        size_t len = ranges_[0].second - ranges_[0].first + 1;
+        body_.push_back({ content + ranges_[0].first, len });
+        buff.Append("Content-Length: ");
+        AppendNumber_(buff, len);
+        buff.Append("\r\n\r\n", 4);
+        return;
+    }
+
+    /* 多区间：先拼好所有分隔头，字符串不再变化后才取指针 */
+    const string& type = GetFileType_();
+    string total = to_string(mmFileStat_.st_size);
+    vector<size_t> offsets;
+    partHeaders_.clear();
+    for(const auto& range: ranges_) {
+        offsets.push_back(partHeaders_.size());
+        partHeaders_ += "\r\n--" + boundary_ + "\r\nContent-Type: " + type + "\r\nContent-Range: bytes "
+                        + to_string(range.first) + "-" + to_string(range.second) + "/" + total + "\r\n\r\n";
+    }
+    offsets.push_back(partHeaders_.size());
+    partHeaders_ += "\r\n--" + boundary_ + "--\r\n";
+    offsets.push_back(partHeaders_.size());
+
+    char* base = &partHeaders_[0];
+    size_t len = partHeaders_.size();
+    for(size_t i = 0; i < ranges_.size(); i++) {
+        body_.push_back({ base + offsets[i], offsets[i + 1] - offsets[i] });
+        body_.push_back({ content + ranges_[i].first, ranges_[i].second - ranges_[i].first + 1 });
+        len += ranges_[i].second - ranges_[i].first + 1;
+    }
+    size_t n = ranges_.size();
+    body_.push_back({ base + offsets[n], offsets[n + 1] - offsets[n] });
+    buff.Append("Content-Length: " + to_string(len) + "\r\n\r\n");
+}
+
+/* 小响应体拷贝到响应头之后，整个响应只占一个片段 */
+void HttpResponse::InlineBody_(ChainBuffer& buff) {
+    size_t total = 0;
+    for(const struct iovec& seg: body_) { total += seg.iov_len; }
+    if(body_.empty() || total > inlineThreshold) { return; }
+    for(const struct iovec& seg: body_) {
+        buff.Append(seg.iov_base, seg.iov_len);
+    }
+    body_.clear();
+    UnmapFile();
 }
 
 void HttpResponse::UnmapFile() {
@@ -147,20 +437,256 @@ void HttpResponse::UnmapFile() {
     }
 }
 
-string HttpResponse::GetFileType_() {
-    /* 判断文件类型 */
+/* 条件请求：If-None-Match 优先，其次 If-Modified-Since（仅 GET/HEAD） */
+bool HttpResponse::IsNotModified_() const {
+    if(!request_) { return false; }
+    const string& method = request_->method();
+    if(method != "GET" && method != "HEAD") { return false; }
+    const HttpHeaders& headers = request_->headers();
+    if(headers.Has(HttpHeaders::IF_NONE_MATCH)) {
+        return MatchEtag_(headers.Get(HttpHeaders::IF_NONE_MATCH));
+    }
+    if(headers.Has(HttpHeaders::IF_MODIFIED_SINCE)) {
+        time_t since = FileCache::ParseHttpDate(headers.Get(HttpHeaders::IF_MODIFIED_SINCE));
+        return since != -1 && fileInfo_.st.st_mtime <= since;
+    }
+    return false;
+}
+
+/* If-None-Match 为逗号分隔的 ETag 列表，按弱比较（忽略 W/ 前缀） */
+bool HttpResponse::MatchEtag_(const string& list) const {
+    size_t pos = 0;
+    while(pos < list.size()) {
+        size_t end = list.find(',', pos);
+        if(end == string::npos) { end = list.size(); }
+        size_t begin = list.find_first_not_of(' ', pos);
+        size_t last = end;
+        while(last > begin && list[last - 1] == ' ') { last--; }
+        if(begin < last) {
+            if(list.compare(begin, last - begin, "*") == 0) { return true; }
+            if(list.compare(begin, 2, "W/") == 0) { begin += 2; }
+            if(list.compare(begin, last - begin, fileInfo_.etag) == 0) { return true; }
+        }
+        pos = end + 1;
+    }
+    return false;
+}
+
+/* 解析 Range: bytes=a-b, c-, -n
+   语法错误、区间过多或 If-Range 不匹配时忽略该头返回完整文件；
+   全部区间都不可满足时返回 416；重叠或相邻的区间合并 */
+void HttpResponse::ParseRange_() {
+    if(!request_ || request_->method() != "GET") { return; }
+    const HttpHeaders& headers = request_->headers();
+    if(!headers.Has(HttpHeaders::RANGE)) { return; }
+    if(headers.Has(HttpHeaders::IF_RANGE) && !IfRangeMatch_(headers.Get(HttpHeaders::IF_RANGE))) { return; }
+
+    const string& spec = headers.Get(HttpHeaders::RANGE);
+    if(spec.compare(0, 6, "bytes=") != 0) { return; }
+    const size_t size = mmFileStat_.st_size;
+    vector<pair<size_t, size_t>> ranges;
+    size_t count = 0;
+    size_t pos = 6;
+    while(pos <= spec.size()) {
+        size_t end = spec.find(',', pos);
+        if(end == string::npos) { end = spec.size(); }
+        size_t begin = spec.find_first_not_of(" \t", pos);
+        size_t last = end;
+        while(last > begin && (spec[last - 1] == ' ' || spec[last - 1] == '\t')) { last--; }
+        pos = end + 1;
+        if(begin >= last) { continue; }   /* 空元素 */
+        if(++count > MAX_RANGES) { return; }
+
+        size_t dash = spec.find('-', begin);
+        if(dash == string::npos || dash >= last) { return; }
+        size_t first = 0, second = 0;
+        bool hasFirst = dash > begin, hasSecond = dash + 1 < last;
+        for(size_t i = begin; i < dash; i++) {
+            if(!isdigit(spec[i]) || first > (SIZE_MAX - 9) / 10) { return; }
+            first = first * 10 + (spec[i] - '0');
+        }
+        for(size_t i = dash + 1; i < last; i++) {
+            if(!isdigit(spec[i]) || second > (SIZE_MAX - 9) / 10) { return; }
+            second = second * 10 + (spec[i] - '0');
+        }
+        if(!hasFirst) {
+            /* 后缀区间：最后 n 个字节 */
+            if(!hasSecond) { return; }
+            if(second == 0 || size == 0) { continue; }
+            ranges.emplace_back(second >= size ? 0 : size - second, size - 1);
+        } else {
+            if(hasSecond && second < first) { return; }
+            if(first >= size) { continue; }
+            ranges.emplace_back(first, (!hasSecond || second >= size) ? size - 1 : second);
+        }
+    }
+    if(count == 0) { return; }
+    if(ranges.empty()) {
+        code_ = 416;
+        return;
+    }
+
+    sort(ranges.begin(), ranges.end());
+    ranges_.clear();
+    for(const auto& range: ranges) {
+        if(!ranges_.empty() && range.first <= ranges_.back().second + 1) {
+            ranges_.back().second = max(ranges_.back().second, range.second);
+        } else {
+            ranges_.push_back(range);
+        }
+    }
+    if(ranges_.size() > 1) {
+        static thread_local mt19937_64 rng(random_device{}());
+        char buf[32];
+        snprintf(buf, sizeof(buf), "%016llx", static_cast<unsigned long long>(rng()));
+        boundary_ = buf;
+    }
+    code_ = 206;
+}
+
+/* If-Range 为 ETag 时做强比较，为日期时要求与修改时间完全一致 */
+bool HttpResponse::IfRangeMatch_(const string& value) const {
+    if(!value.empty() && value[0] == '"') {
+        return value == fileInfo_.etag;
+    }
+    time_t t = FileCache::ParseHttpDate(value);
+    return t != -1 && t == fileInfo_.st.st_mtime;
+}
+
+/* 按 Accept-Encoding 选择表示：优先预压缩的 .br / .gz 旁路文件（不早于原文件才用），
+   其次使用 gzip 压缩缓存。不同表示的 ETag 不同，之后的条件请求和区间都针对所选表示 */
+void HttpResponse::SelectEncoding_() {
+    if(!request_ || !IsCompressible_()) { return; }
+    const string& accept = request_->headers().Get(HttpHeaders::ACCEPT_ENCODING);
+    if(accept.empty()) { return; }
+
+    FileCache::Entry& side = sidecarInfo_;
+    static const char* const SIDECARS[][2] = { { "br", ".br" }, { "gzip", ".gz" } };
+    for(const auto& sidecar: SIDECARS) {
+        if(EncodingQuality_(accept, sidecar[0]) <= 0) { continue; }
+        if(FileCache::Instance()->Lookup(FullPath_(sidecar[1]), &side) && S_ISREG(side.st.st_mode)
+           && (side.st.st_mode & S_IROTH) && side.st.st_mtime >= fileInfo_.st.st_mtime) {
+            encoding_ = sidecar[0];
+            sidecar_ = sidecar[1];
+            fileInfo_ = side;
+            mmFileStat_ = side.st;
+            return;
+        }
+    }
+
+    if(EncodingQuality_(accept, "gzip") <= 0 || static_cast<size_t>(fileInfo_.st.st_size) < minCompressSize) {
+        return;
+    }
+    if(noBlock_) {
+        /* 尚未压缩过的文件不在 Reactor 线程上压缩 */
+        if(!GzipCache::Instance()->Find(FullPath_(), fileInfo_, &encoded_)) {
+            wouldBlock_ = true;
+            return;
+        }
+    } else {
+        encoded_ = GzipCache::Instance()->Get(FullPath_(), fileInfo_);
+    }
+    if(encoded_) {
+        encoding_ = "gzip";
+        fileInfo_.etag.insert(fileInfo_.etag.size() - 1, "-gz");
+        mmFileStat_.st_size = encoded_->size();
+    }
+}
+
+bool HttpResponse::IsCompressible_() const {
+    return IsCompressible(GetSuffix_());
+}
+
+bool HttpResponse::IsCompressible(const string& suffix) {
+    return COMPRESS_SUFFIX.count(suffix) == 1;
+}
+
+string HttpResponse::CacheHeaders(const FileCache::Entry& info, const string& suffix) {
+    string headers;
+    AppendCacheHeaders(info, suffix, &headers);
+    return headers;
+}
+
+void HttpResponse::AppendCacheHeaders(const FileCache::Entry& info, const string& suffix, string* out) {
+    out->append("ETag: ").append(info.etag).append("\r\n");
+    out->append("Last-Modified: ").append(info.lastModified).append("\r\n");
+    auto it = CACHE_MAX_AGE.find(suffix);
+    int maxAge = (it == CACHE_MAX_AGE.end()) ? 0 : it->second;
+    if(maxAge > 0) {
+        char digits[16];
+        snprintf(digits, sizeof(digits), "%d", maxAge);
+        out->append("Cache-Control: public, max-age=").append(digits).append("\r\n");
+    } else if(maxAge == 0) {
+        out->append("Cache-Control: no-cache\r\n");
+    }
+    if(IsCompressible(suffix)) {
+        out->append("Vary: Accept-Encoding\r\n");
+    }
+}
+
+/* 取 Accept-Encoding 中某编码的 q 值；未列出时取 * 的 q 值，都没有为 0 */
+double HttpResponse::EncodingQuality_(const string& accept, const char* coding) {
+    double q = 0, star = 0;
+    bool found = false, hasStar = false;
+    size_t pos = 0;
+    while(pos < accept.size()) {
+        size_t end = accept.find(',', pos);
+        if(end == string::npos) { end = accept.size(); }
+        size_t begin = accept.find_first_not_of(" \t", pos);
+        pos = end + 1;
+        if(begin >= end) { continue; }
+        size_t semi = accept.find(';', begin);
+        size_t last = (semi == string::npos || semi > end) ? end : semi;
+        while(last > begin && (accept[last - 1] == ' ' || accept[last - 1] == '\t')) { last--; }
+
+        double value = 1;
+        if(semi != string::npos && semi < end) {
+            size_t qpos = accept.find("q=", semi);
+            if(qpos != string::npos && qpos < end) { value = atof(accept.c_str() + qpos + 2); }
+        }
+        size_t len = last - begin;
+        if(len == strlen(coding) && strncasecmp(accept.c_str() + begin, coding, len) == 0) {
+            q = value;
+            found = true;
+        } else if(len == 1 && accept[begin] == '*') {
+            star = value;
+            hasStar = true;
+        }
+    }
+    if(found) { return q; }
+    return hasStar ? star : 0;
+}
+
+bool HttpResponse::SetCacheMaxAge(const string& suffix, int seconds) {
+    assert(!cacheConfigLocked_);
+    if(cacheConfigLocked_) {
+        LOG_ERROR("SetCacheMaxAge(%s) after server start ignored", suffix.c_str());
+        return false;
+    }
+    CACHE_MAX_AGE[suffix] = seconds;
+    return true;
+}
+
+void HttpResponse::LockCacheConfig() {
+    cacheConfigLocked_ = true;
+}
+
+string HttpResponse::GetSuffix_() const {
     string::size_type idx = path_.find_last_of('.');
     if(idx == string::npos) {
-        return "text/plain";
-    }
-    string suffix = path_.substr(idx);
-    if(SUFFIX_TYPE.count(suffix) == 1) {
-        return SUFFIX_TYPE.find(suffix)->second;
+        return "";
     }
-    return "text/plain";
+    return path_.substr(idx);
+}
+
+const string& HttpResponse::GetFileType_() const {
+    /* 判断文件类型 */
+    static const string DEFAULT_TYPE = "text/plain";
+    auto it = SUFFIX_TYPE.find(GetSuffix_());
+    return it == SUFFIX_TYPE.end() ? DEFAULT_TYPE : it->second;
 }
 
-void HttpResponse::ErrorContent(Buffer& buff, string message) 
+void HttpResponse::ErrorContent(ChainBuffer& buff, string message) 
 {
     string body;
     string status;
@@ -175,6 +701,6 @@ void HttpResponse::ErrorContent(Buffer& buff, string message)
     body += "<p>" + message + "</p>";
     body += "<hr><em>TinyWebServer</em></body></html>";
 
-    buff.Append("Content-length: " + to_string(body.size()) + "\r\n\r\n");
+    buff.Append("Content-Length: " + to_string(body.size()) + "\r\n\r\n");
     buff.Append(body);
 }
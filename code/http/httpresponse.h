@@ -7,47 +7,131 @@
 #define HTTP_RESPONSE_H
 
 #include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include <memory>
+#include <atomic>
 #include <fcntl.h>       // open
 #include <unistd.h>      // close
 #include <sys/stat.h>    // stat
 #include <sys/mman.h>    // mmap, munmap
+#include <sys/uio.h>     // iovec
 
-#include "../buffer/buffer.h"
+#include "../buffer/chainbuffer.h"
 #include "../log/log.h"
+#include "filecache.h"
+#include "gzipcache.h"
+#include "resourceimage.h"
+
+class HttpRequest;
 
 class HttpResponse {
 public:
     HttpResponse();
     ~HttpResponse();
 
-    void Init(const std::string& srcDir, std::string& path, bool isKeepAlive = false, int code = -1);
-    void MakeResponse(Buffer& buff);
+    void Init(const char* srcDir, const std::string& path, bool isKeepAlive = false, int code = -1,
+              const HttpRequest* request = nullptr);
+    /* 生成响应；不可阻塞模式下需要读盘或压缩时返回 false，且不向 buff 写入任何内容 */
+    bool MakeResponse(ChainBuffer& buff);
+    /* 不可阻塞模式：只使用内存中已有的内容（资源镜像、小文件缓存、压缩缓存），供 Reactor 线程内联响应 */
+    void SetNoBlock(bool noBlock) { noBlock_ = noBlock; }
     void UnmapFile();
     char* File();
     size_t FileLen() const;
-    void ErrorContent(Buffer& buff, std::string message);
+    /* 映射文件的磁盘路径（含预压缩后缀） */
+    const std::string& FilePath() { return FullPath_(sidecar_.c_str()); }
+    /* 响应头之后待发送的片段：整个文件、单个区间，或 multipart/byteranges 的分隔头与各区间交替 */
+    const std::vector<struct iovec>& Body() const { return body_; }
+    void ErrorContent(ChainBuffer& buff, std::string message);
     int Code() const { return code_; }
 
+    /* 按后缀配置 Cache-Control 的 max-age（秒）：0 为 no-cache，负数不发送。
+       只能在构造 HttpServer 之前调用：之后工作线程会无锁读取该表，资源镜像也已按它生成了响应头，
+       配置已锁定时返回 false 且不生效 */
+    static bool SetCacheMaxAge(const std::string& suffix, int seconds);
+    /* 锁定缓存配置，由 HttpServer 构造时最先调用（早于处理请求和生成资源镜像） */
+    static void LockCacheConfig();
+
+    /* 单个请求允许的最多区间数，超过时忽略 Range 返回完整文件 */
+    static const size_t MAX_RANGES = 16;
+
+    /* 小于该字节数的文件不做即时压缩 */
+    static size_t minCompressSize;
+
+    /* 响应体不超过该字节数时直接拷贝到写缓冲区，与响应头一次发出 */
+    static size_t inlineThreshold;
+
+    /* Keep-Alive 头中的 timeout（秒），由 HttpServer 按连接超时设置，0 不发送 */
+    static int keepAliveTimeout;
+    /* Server 头 */
+    static const char* serverName;
+
+    /* ETag / Last-Modified / Cache-Control / Vary 响应头（资源镜像构建时预先生成，与动态响应一致） */
+    static std::string CacheHeaders(const FileCache::Entry& info, const std::string& suffix);
+    static void AppendCacheHeaders(const FileCache::Entry& info, const std::string& suffix, std::string* out);
+    static bool IsCompressible(const std::string& suffix);
+
 private:
-    void AddStateLine_(Buffer &buff);
-    void AddHeader_(Buffer &buff);
-    void AddContent_(Buffer &buff);
+    void AddStateLine_(ChainBuffer& buff);
+    void AddHeader_(ChainBuffer& buff);
+    void AddContent_(ChainBuffer& buff);
 
     void ErrorHtml_();
-    std::string GetFileType_();
+    bool IsNotModified_() const;
+    bool MatchEtag_(const std::string& list) const;
+    bool FromImage_();
+    bool WouldBlock_();
+    void SelectEncoding_();
+    bool IsCompressible_() const;
+    static double EncodingQuality_(const std::string& accept, const char* coding);
+    void ParseRange_();
+    bool IfRangeMatch_(const std::string& value) const;
+    void AddBody_(ChainBuffer& buff, char* content);
+    void InlineBody_(ChainBuffer& buff);
+    static const std::string& DateHeader_();
+    std::string GetSuffix_() const;
+    const std::string& GetFileType_() const;
+    /* srcDir_ + path_ + suffix，拼在复用的 filePath_ 中 */
+    const std::string& FullPath_(const char* suffix = "");
+    static void AppendNumber_(ChainBuffer& buff, long long num);
 
     int code_;
     bool isKeepAlive_;
+    bool noBlock_;
+    bool wouldBlock_;
 
     std::string path_;
     std::string srcDir_;
     
+    const HttpRequest* request_;
+    FileCache::Entry fileInfo_;  /* 文件元数据及 ETag / Last-Modified */
+
+    /* 以下为各请求复用的临时空间，容量在连接上保留，预热后构造响应不再分配内存 */
+    std::string filePath_;
+    std::string headerScratch_;
+    FileCache::Entry sidecarInfo_;
+
     char* mmFile_; 
     struct stat mmFileStat_;
 
+    std::vector<std::pair<size_t, size_t>> ranges_;  /* 206 的区间 [first, last] */
+    std::string boundary_;
+    std::string partHeaders_;                        /* 多区间时各部分的分隔头 */
+    std::vector<struct iovec> body_;
+
+    std::string encoding_;                           /* Content-Encoding，空为原文 */
+    std::string sidecar_;                            /* 预压缩文件后缀 ".br" / ".gz" */
+    std::shared_ptr<const std::string> encoded_;     /* 内存中的 gzip 压缩结果 */
+    std::shared_ptr<const std::string> content_;     /* 文件缓存中的小文件内容 */
+    const ResourceImage::Variant* image_;            /* 命中资源镜像时所选的表示 */
+
     static const std::unordered_map<std::string, std::string> SUFFIX_TYPE;
     static const std::unordered_map<int, std::string> CODE_STATUS;
     static const std::unordered_map<int, std::string> CODE_PATH;
+    static std::unordered_map<std::string, int> CACHE_MAX_AGE;   /* 锁定后只读 */
+    static std::atomic<bool> cacheConfigLocked_;
+    static const std::unordered_set<std::string> COMPRESS_SUFFIX;
 };
 
 
@@ -0,0 +1,611 @@
+//
+// Created by moon on 25-3-21.
+//
+
+#include "json.h"
+#include <cstdlib>
+#include <cerrno>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+namespace {
+
+// 64 字节块的字符分类位掩码，第 i 位对应块内第 i 个字节
+struct BlockMasks {
+	uint64_t quote;
+	uint64_t backslash;
+	uint64_t op;        // { } [ ] : ,
+	uint64_t space;     // 空格 \t \r \n
+	uint64_t control;   // 0x00 ~ 0x1F
+};
+
+typedef void (*ClassifyFn)(const char *block, BlockMasks *masks);
+
+void ClassifyScalar(const char *block, BlockMasks *masks) {
+	BlockMasks m = {0, 0, 0, 0, 0};
+	for (int i = 0; i < 64; i++) {
+		uint64_t bit = uint64_t(1) << i;
+		if (static_cast<unsigned char>(block[i]) < 0x20) { m.control |= bit; }
+		switch (block[i]) {
+		case '"': m.quote |= bit; break;
+		case '\\': m.backslash |= bit; break;
+		case '{': case '}': case '[': case ']': case ':': case ',': m.op |= bit; break;
+		case ' ': case '\t': case '\r': case '\n': m.space |= bit; break;
+		default: break;
+		}
+	}
+	*masks = m;
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+__attribute__((target("sse2")))
+uint64_t Eq16(const __m128i chunk[4], char ch) {
+	const __m128i needle = _mm_set1_epi8(ch);
+	uint64_t r0 = static_cast<uint16_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(chunk[0], needle)));
+	uint64_t r1 = static_cast<uint16_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(chunk[1], needle)));
+	uint64_t r2 = static_cast<uint16_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(chunk[2], needle)));
+	uint64_t r3 = static_cast<uint16_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(chunk[3], needle)));
+	return r0 | (r1 << 16) | (r2 << 32) | (r3 << 48);
+}
+
+// 无符号 <= 0x1F：max(x, 0x1F) == 0x1F
+__attribute__((target("sse2")))
+uint64_t Control16(const __m128i chunk[4]) {
+	const __m128i limit = _mm_set1_epi8(0x1F);
+	uint64_t r[4];
+	for (int i = 0; i < 4; i++) {
+		r[i] = static_cast<uint16_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_max_epu8(chunk[i], limit), limit)));
+	}
+	return r[0] | (r[1] << 16) | (r[2] << 32) | (r[3] << 48);
+}
+
+__attribute__((target("sse2")))
+void ClassifySse2(const char *block, BlockMasks *masks) {
+	__m128i chunk[4];
+	for (int i = 0; i < 4; i++) {
+		chunk[i] = _mm_loadu_si128(reinterpret_cast<const __m128i *>(block + 16 * i));
+	}
+	masks->quote = Eq16(chunk, '"');
+	masks->backslash = Eq16(chunk, '\\');
+	masks->op = Eq16(chunk, '{') | Eq16(chunk, '}') | Eq16(chunk, '[') | Eq16(chunk, ']')
+	            | Eq16(chunk, ':') | Eq16(chunk, ',');
+	masks->space = Eq16(chunk, ' ') | Eq16(chunk, '\t') | Eq16(chunk, '\r') | Eq16(chunk, '\n');
+	masks->control = Control16(chunk);
+}
+
+__attribute__((target("avx2")))
+uint64_t Eq32(const __m256i chunk[2], char ch) {
+	const __m256i needle = _mm256_set1_epi8(ch);
+	uint64_t lo = static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(chunk[0], needle)));
+	uint64_t hi = static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(chunk[1], needle)));
+	return lo | (hi << 32);
+}
+
+__attribute__((target("avx2")))
+uint64_t Control32(const __m256i chunk[2]) {
+	const __m256i limit = _mm256_set1_epi8(0x1F);
+	uint64_t lo = static_cast<uint32_t>(_mm256_movemask_epi8(
+		_mm256_cmpeq_epi8(_mm256_max_epu8(chunk[0], limit), limit)));
+	uint64_t hi = static_cast<uint32_t>(_mm256_movemask_epi8(
+		_mm256_cmpeq_epi8(_mm256_max_epu8(chunk[1], limit), limit)));
+	return lo | (hi << 32);
+}
+
+__attribute__((target("avx2")))
+void ClassifyAvx2(const char *block, BlockMasks *masks) {
+	__m256i chunk[2];
+	chunk[0] = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(block));
+	chunk[1] = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(block + 32));
+	masks->quote = Eq32(chunk, '"');
+	masks->backslash = Eq32(chunk, '\\');
+	masks->op = Eq32(chunk, '{') | Eq32(chunk, '}') | Eq32(chunk, '[') | Eq32(chunk, ']')
+	            | Eq32(chunk, ':') | Eq32(chunk, ',');
+	masks->space = Eq32(chunk, ' ') | Eq32(chunk, '\t') | Eq32(chunk, '\r') | Eq32(chunk, '\n');
+	masks->control = Control32(chunk);
+}
+#endif
+
+struct Classifier {
+	ClassifyFn fn;
+	const char *name;
+};
+
+const Classifier &SelectClassifier() {
+	static const Classifier classifier = [] {
+#if defined(__x86_64__) || defined(__i386__)
+		__builtin_cpu_init();
+		if (__builtin_cpu_supports("avx2")) { return Classifier{ClassifyAvx2, "avx2"}; }
+		if (__builtin_cpu_supports("sse2")) { return Classifier{ClassifySse2, "sse2"}; }
+#endif
+		return Classifier{ClassifyScalar, "scalar"};
+	}();
+	return classifier;
+}
+
+// 前缀异或：第 i 位 = 第 0..i 位的异或，用于由引号位置得到字符串内区间
+inline uint64_t PrefixXor(uint64_t x) {
+	x ^= x << 1;
+	x ^= x << 2;
+	x ^= x << 4;
+	x ^= x << 8;
+	x ^= x << 16;
+	x ^= x << 32;
+	return x;
+}
+
+inline bool IsDigit(char ch) {
+	return ch >= '0' && ch <= '9';
+}
+
+inline bool IsDelim(char ch) {
+	switch (ch) {
+	case '{': case '}': case '[': case ']': case ':': case ',':
+	case ' ': case '\t': case '\r': case '\n':
+		return true;
+	default:
+		return false;
+	}
+}
+
+int HexValue(char ch) {
+	if (ch >= '0' && ch <= '9') { return ch - '0'; }
+	if (ch >= 'a' && ch <= 'f') { return ch - 'a' + 10; }
+	if (ch >= 'A' && ch <= 'F') { return ch - 'A' + 10; }
+	return -1;
+}
+
+bool ReadHex4(const char *p, const char *end, unsigned *out) {
+	if (end - p < 4) { return false; }
+	unsigned v = 0;
+	for (int i = 0; i < 4; i++) {
+		int h = HexValue(p[i]);
+		if (h < 0) { return false; }
+		v = (v << 4) | static_cast<unsigned>(h);
+	}
+	*out = v;
+	return true;
+}
+
+// p 指向未被转义的反斜杠，检查其后是否为合法转义：" \\ / b f n r t 或 \uXXXX，
+// 高代理项须紧跟 \u 低代理项（与 GetString 的解码规则一致）
+bool ValidEscape(const char *p, const char *end) {
+	if (end - p < 2) { return false; }
+	switch (p[1]) {
+	case '"': case '\\': case '/': case 'b': case 'f': case 'n': case 'r': case 't':
+		return true;
+	case 'u': {
+		unsigned cp, low;
+		if (!ReadHex4(p + 2, end, &cp)) { return false; }
+		if (cp < 0xD800 || cp > 0xDBFF) { return true; }
+		p += 6;
+		return end - p >= 6 && p[0] == '\\' && p[1] == 'u' && ReadHex4(p + 2, end, &low)
+		       && low >= 0xDC00 && low <= 0xDFFF;
+	}
+	default:
+		return false;
+	}
+}
+
+char *EncodeUtf8(unsigned cp, char *dst) {
+	if (cp < 0x80) {
+		*dst++ = static_cast<char>(cp);
+	} else if (cp < 0x800) {
+		*dst++ = static_cast<char>(0xC0 | (cp >> 6));
+		*dst++ = static_cast<char>(0x80 | (cp & 0x3F));
+	} else if (cp < 0x10000) {
+		*dst++ = static_cast<char>(0xE0 | (cp >> 12));
+		*dst++ = static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+		*dst++ = static_cast<char>(0x80 | (cp & 0x3F));
+	} else {
+		*dst++ = static_cast<char>(0xF0 | (cp >> 18));
+		*dst++ = static_cast<char>(0x80 | ((cp >> 12) & 0x3F));
+		*dst++ = static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+		*dst++ = static_cast<char>(0x80 | (cp & 0x3F));
+	}
+	return dst;
+}
+
+} // namespace
+
+/******************** JsonDoc ********************/
+
+JsonDoc::JsonDoc() {
+	Clear();
+}
+
+void JsonDoc::Clear() {
+	data_ = nullptr;
+	len_ = 0;
+	arena_ = nullptr;
+	index_ = nullptr;
+	match_ = nullptr;
+	count_ = 0;
+	valid_ = false;
+}
+
+const char *JsonDoc::Impl() {
+	return SelectClassifier().name;
+}
+
+bool JsonDoc::Parse(const char *data, size_t len, Arena *arena) {
+	assert(arena);
+	Clear();
+	if (len >= UINT32_MAX) { return false; }
+	data_ = data;
+	len_ = len;
+	arena_ = arena;
+	valid_ = BuildIndex_() && Validate_();
+	return valid_;
+}
+
+JsonValue JsonDoc::Root() const {
+	return valid_ ? JsonValue(this, 0) : JsonValue();
+}
+
+bool JsonDoc::BuildIndex_() {
+	/* 每个字节至多贡献一个位置，再加一个哨兵 */
+	index_ = arena_->AllocateArray<uint32_t>(len_ + 1);
+	ClassifyFn classify = SelectClassifier().fn;
+
+	uint64_t prevEscaped = 0;   // 上一块最后一个字节是未被转义的反斜杠
+	uint64_t prevInString = 0;  // 上一块结束时仍在字符串内（全 0 或全 1）
+	uint64_t prevScalar = 0;    // 上一块最后一个字节属于标量
+	char tail[64];
+
+	for (size_t base = 0; base < len_; base += 64) {
+		const char *block = data_ + base;
+		if (len_ - base < 64) {
+			/* 末块用空白补齐，空白不会产生任何索引 */
+			memset(tail, ' ', sizeof(tail));
+			memcpy(tail, block, len_ - base);
+			block = tail;
+		}
+		BlockMasks m;
+		classify(block, &m);
+
+		/* 转义：逐个处理反斜杠（常见 JSON 中很少出现） */
+		uint64_t escaped = prevEscaped;
+		prevEscaped = 0;
+		uint64_t bs = m.backslash;
+		while (bs) {
+			int i = __builtin_ctzll(bs);
+			bs &= bs - 1;
+			if (escaped & (uint64_t(1) << i)) { continue; }
+			if (!ValidEscape(data_ + base + i, data_ + len_)) { return false; }
+			if (i == 63) { prevEscaped = 1; }
+			else { escaped |= uint64_t(1) << (i + 1); }
+		}
+
+		uint64_t quote = m.quote & ~escaped;
+		uint64_t inString = PrefixXor(quote) ^ prevInString;
+		prevInString = static_cast<uint64_t>(static_cast<int64_t>(inString) >> 63);
+		if (m.control & inString) { return false; }   // 字符串内未转义的控制字符
+
+		uint64_t op = m.op & ~inString;
+		uint64_t openQuote = quote & inString;
+		uint64_t scalar = ~(m.op | m.space | m.quote) & ~inString;
+		uint64_t scalarStart = scalar & ~((scalar << 1) | prevScalar);
+		prevScalar = scalar >> 63;
+
+		uint64_t structural = op | openQuote | scalarStart;
+		while (structural) {
+			index_[count_++] = static_cast<uint32_t>(base + __builtin_ctzll(structural));
+			structural &= structural - 1;
+		}
+	}
+	if (prevInString) { return false; }   // 字符串未结束
+	index_[count_] = static_cast<uint32_t>(len_);
+	return count_ > 0;
+}
+
+bool JsonDoc::Validate_() {
+	enum Expect {
+		VALUE,
+		VALUE_OR_END,   // '[' 之后
+		KEY,
+		KEY_OR_END,     // '{' 之后
+		COLON,
+		COMMA_OR_END,
+		DONE,
+	};
+	match_ = arena_->AllocateArray<uint32_t>(count_ + 1);
+	uint32_t stack[MAX_DEPTH];
+	int depth = 0;
+	Expect expect = VALUE;
+
+	for (uint32_t i = 0; i < count_; i++) {
+		char ch = At_(i);
+		bool close = false;
+		switch (expect) {
+		case VALUE:
+		case VALUE_OR_END:
+			if (ch == ']' && expect == VALUE_OR_END) {
+				close = true;
+			} else if (ch == '{' || ch == '[') {
+				if (depth == MAX_DEPTH) { return false; }
+				stack[depth++] = i;
+				expect = (ch == '{') ? KEY_OR_END : VALUE_OR_END;
+			} else if (ch == '"' || ValidateScalar_(index_[i])) {
+				expect = depth ? COMMA_OR_END : DONE;
+			} else {
+				return false;
+			}
+			break;
+		case KEY:
+		case KEY_OR_END:
+			if (ch == '}' && expect == KEY_OR_END) {
+				close = true;
+			} else if (ch == '"') {
+				expect = COLON;
+			} else {
+				return false;
+			}
+			break;
+		case COLON:
+			if (ch != ':') { return false; }
+			expect = VALUE;
+			break;
+		case COMMA_OR_END: {
+			char open = At_(stack[depth - 1]);
+			if (ch == ',') {
+				expect = (open == '{') ? KEY : VALUE;
+			} else if ((ch == '}' && open == '{') || (ch == ']' && open == '[')) {
+				close = true;
+			} else {
+				return false;
+			}
+			break;
+		}
+		case DONE:
+		default:
+			return false;
+		}
+		if (close) {
+			match_[stack[--depth]] = i;
+			expect = depth ? COMMA_OR_END : DONE;
+		}
+	}
+	return expect == DONE;
+}
+
+bool JsonDoc::ValidateScalar_(uint32_t pos) const {
+	const char *p = data_ + pos;
+	const char *end = data_ + len_;
+	const char *tokenEnd = p;
+	while (tokenEnd < end && !IsDelim(*tokenEnd) && *tokenEnd != '"') { tokenEnd++; }
+	size_t n = tokenEnd - p;
+	if (*p == 't') { return n == 4 && memcmp(p, "true", 4) == 0; }
+	if (*p == 'f') { return n == 5 && memcmp(p, "false", 5) == 0; }
+	if (*p == 'n') { return n == 4 && memcmp(p, "null", 4) == 0; }
+	/* -?(0|[1-9][0-9]*)(\.[0-9]+)?([eE][+-]?[0-9]+)? */
+	if (p < tokenEnd && *p == '-') { p++; }
+	if (p == tokenEnd || !IsDigit(*p)) { return false; }
+	if (*p == '0') { p++; }
+	else { while (p < tokenEnd && IsDigit(*p)) { p++; } }
+	if (p < tokenEnd && *p == '.') {
+		p++;
+		if (p == tokenEnd || !IsDigit(*p)) { return false; }
+		while (p < tokenEnd && IsDigit(*p)) { p++; }
+	}
+	if (p < tokenEnd && (*p == 'e' || *p == 'E')) {
+		p++;
+		if (p < tokenEnd && (*p == '+' || *p == '-')) { p++; }
+		if (p == tokenEnd || !IsDigit(*p)) { return false; }
+		while (p < tokenEnd && IsDigit(*p)) { p++; }
+	}
+	return p == tokenEnd;
+}
+
+const char *JsonDoc::StringEnd_(uint32_t pos) const {
+	const char *p = data_ + pos + 1;
+	const char *end = data_ + len_;
+	while (p < end) {
+		const char *q = static_cast<const char *>(memchr(p, '"', end - p));
+		if (!q) { return end; }
+		/* 前面连续反斜杠为偶数个时才是结束引号 */
+		const char *b = q;
+		while (b > p && b[-1] == '\\') { b--; }
+		if (((q - b) & 1) == 0) { return q; }
+		p = q + 1;
+	}
+	return end;
+}
+
+/******************** JsonValue ********************/
+
+JsonValue::Type JsonValue::GetType() const {
+	if (!doc_) { return INVALID; }
+	switch (doc_->At_(idx_)) {
+	case '{': return OBJECT;
+	case '[': return ARRAY;
+	case '"': return STRING;
+	case 't': case 'f': return BOOL;
+	case 'n': return NUL;
+	default: return NUMBER;
+	}
+}
+
+uint32_t JsonValue::Next_() const {
+	char ch = doc_->At_(idx_);
+	if (ch == '{' || ch == '[') { return doc_->match_[idx_] + 1; }
+	return idx_ + 1;
+}
+
+JsonValue JsonValue::operator[](const char *key) const {
+	if (GetType() != OBJECT) { return JsonValue(); }
+	size_t keyLen = strlen(key);
+	uint32_t j = idx_ + 1;
+	while (doc_->At_(j) != '}') {
+		JsonValue name(doc_, j);
+		JsonValue value(doc_, j + 2);
+		JsonString raw = name.Raw();
+		/* 大多数键不含转义，直接与原文比较 */
+		if (raw.size == keyLen || memchr(raw.data, '\\', raw.size)) {
+			JsonString decoded;
+			if (name.GetString(&decoded) && decoded.size == keyLen && memcmp(decoded.data, key, keyLen) == 0) {
+				return value;
+			}
+		}
+		j = value.Next_();
+		if (doc_->At_(j) == ',') { j++; }
+	}
+	return JsonValue();
+}
+
+JsonValue JsonValue::operator[](size_t i) const {
+	if (GetType() != ARRAY) { return JsonValue(); }
+	uint32_t j = idx_ + 1;
+	for (size_t n = 0; doc_->At_(j) != ']'; n++) {
+		JsonValue value(doc_, j);
+		if (n == i) { return value; }
+		j = value.Next_();
+		if (doc_->At_(j) == ',') { j++; }
+	}
+	return JsonValue();
+}
+
+size_t JsonValue::Size() const {
+	Type type = GetType();
+	if (type != OBJECT && type != ARRAY) { return 0; }
+	size_t n = 0;
+	uint32_t j = idx_ + 1;
+	while (doc_->At_(j) != '}' && doc_->At_(j) != ']') {
+		JsonValue value(doc_, type == OBJECT ? j + 2 : j);
+		n++;
+		j = value.Next_();
+		if (doc_->At_(j) == ',') { j++; }
+	}
+	return n;
+}
+
+JsonString JsonValue::Raw() const {
+	JsonString raw = {"", 0};
+	if (!doc_) { return raw; }
+	uint32_t pos = doc_->index_[idx_];
+	const char *p = doc_->data_ + pos;
+	const char *end = doc_->data_ + doc_->len_;
+	switch (GetType()) {
+	case STRING:
+		raw.data = p + 1;
+		raw.size = doc_->StringEnd_(pos) - raw.data;
+		break;
+	case OBJECT:
+	case ARRAY:
+		break;
+	default: {
+		const char *q = p;
+		while (q < end && !IsDelim(*q)) { q++; }
+		raw.data = p;
+		raw.size = q - p;
+		break;
+	}
+	}
+	return raw;
+}
+
+bool JsonValue::GetString(JsonString *out) const {
+	if (GetType() != STRING) { return false; }
+	JsonString raw = Raw();
+	const char *p = raw.data;
+	const char *end = p + raw.size;
+	const char *bs = static_cast<const char *>(memchr(p, '\\', raw.size));
+	if (!bs) {
+		*out = raw;
+		return true;
+	}
+	/* 含转义：在 Arena 中解码，解码结果不会比原文长 */
+	char *buf = static_cast<char *>(doc_->arena_->Allocate(raw.size + 1, 1));
+	size_t prefix = bs - p;
+	memcpy(buf, p, prefix);
+	char *dst = buf + prefix;
+	p = bs;
+	while (p < end) {
+		if (*p != '\\') {
+			*dst++ = *p++;
+			continue;
+		}
+		if (++p == end) { return false; }
+		switch (*p++) {
+		case '"': *dst++ = '"'; break;
+		case '\\': *dst++ = '\\'; break;
+		case '/': *dst++ = '/'; break;
+		case 'b': *dst++ = '\b'; break;
+		case 'f': *dst++ = '\f'; break;
+		case 'n': *dst++ = '\n'; break;
+		case 'r': *dst++ = '\r'; break;
+		case 't': *dst++ = '\t'; break;
+		case 'u': {
+			unsigned cp;
+			if (!ReadHex4(p, end, &cp)) { return false; }
+			p += 4;
+			if (cp >= 0xD800 && cp <= 0xDBFF) {
+				unsigned low;
+				if (end - p < 6 || p[0] != '\\' || p[1] != 'u' || !ReadHex4(p + 2, end, &low)
+				    || low < 0xDC00 || low > 0xDFFF) {
+					return false;
+				}
+				p += 6;
+				cp = 0x10000 + ((cp - 0xD800) << 10) + (low - 0xDC00);
+			}
+			dst = EncodeUtf8(cp, dst);
+			break;
+		}
+		default:
+			return false;
+		}
+	}
+	*dst = '\0';
+	out->data = buf;
+	out->size = dst - buf;
+	return true;
+}
+
+bool JsonValue::GetDouble(double *out) const {
+	if (GetType() != NUMBER) { return false; }
+	JsonString raw = Raw();
+	char buf[64];
+	if (raw.size >= sizeof(buf)) { return false; }
+	memcpy(buf, raw.data, raw.size);
+	buf[raw.size] = '\0';
+	*out = strtod(buf, nullptr);
+	return true;
+}
+
+bool JsonValue::GetInt64(long long *out) const {
+	if (GetType() != NUMBER) { return false; }
+	JsonString raw = Raw();
+	char buf[32];
+	if (raw.size >= sizeof(buf)) { return false; }
+	memcpy(buf, raw.data, raw.size);
+	buf[raw.size] = '\0';
+	char *end = nullptr;
+	errno = 0;
+	long long v = strtoll(buf, &end, 10);
+	if (errno == ERANGE || *end != '\0') { return false; }   // 小数或超出范围
+	*out = v;
+	return true;
+}
+
+bool JsonValue::GetBool(bool *out) const {
+	if (GetType() != BOOL) { return false; }
+	*out = (doc_->At_(idx_) == 't');
+	return true;
+}
+
+std::string JsonValue::AsString() const {
+	JsonString str;
+	switch (GetType()) {
+	case STRING:
+		if (GetString(&str)) { return std::string(str.data, str.size); }
+		return "";
+	case NUMBER:
+	case BOOL:
+	case NUL:
+		str = Raw();
+		return std::string(str.data, str.size);
+	default:
+		return "";
+	}
+}
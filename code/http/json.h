@@ -0,0 +1,149 @@
+//
+// Created by moon on 25-3-21.
+//
+
+#ifndef JSON_H
+#define JSON_H
+
+#include <string>
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+
+#include "../buffer/arena.h"
+
+class JsonDoc;
+
+// 指向请求缓冲区或 Arena 的字符串片段
+struct JsonString {
+	const char *data;
+	size_t size;
+
+	bool operator==(const char *str) const {
+		return strlen(str) == size && memcmp(str, data, size) == 0;
+	}
+};
+
+// JSON 值句柄：只记录在结构索引中的位置，取值时才去原文中解析（惰性物化）
+// 句柄本身很小，可按值传递；生命周期不超过所属 JsonDoc 及请求体缓冲区
+class JsonValue {
+public:
+	enum Type {
+		INVALID = 0,
+		NUL,
+		BOOL,
+		NUMBER,
+		STRING,
+		ARRAY,
+		OBJECT,
+	};
+
+	JsonValue() : doc_(nullptr), idx_(0) {}
+
+	Type GetType() const;
+
+	bool IsValid() const { return doc_ != nullptr; }
+
+	// 对象成员，不存在或类型不符时返回无效值
+	JsonValue operator[](const char *key) const;
+
+	// 数组元素，越界或类型不符时返回无效值
+	JsonValue operator[](size_t i) const;
+
+	// 数组元素个数 / 对象成员个数
+	size_t Size() const;
+
+	// 反转义后的字符串：不含转义时直接指向原文，否则在 Arena 中解码
+	bool GetString(JsonString *out) const;
+
+	bool GetDouble(double *out) const;
+
+	bool GetInt64(long long *out) const;
+
+	bool GetBool(bool *out) const;
+
+	// 标量的原始文本（字符串不含引号且未反转义）
+	JsonString Raw() const;
+
+	// 便捷接口：字符串返回解码值，其他标量返回原始文本，容器返回空串
+	std::string AsString() const;
+
+	// 遍历对象成员：f(JsonString key, JsonValue value)
+	template<class F>
+	void ForEachMember(F &&f) const;
+
+private:
+	friend class JsonDoc;
+
+	JsonValue(const JsonDoc *doc, uint32_t idx) : doc_(doc), idx_(idx) {}
+
+	// 本值之后的下一个结构索引
+	uint32_t Next_() const;
+
+	const JsonDoc *doc_;
+	uint32_t idx_;      // 在结构索引中的下标
+};
+
+// JSON 文档
+// 第一阶段按 64 字节分块，用 SIMD（AVX2 / SSE2，启动时选择，否则标量）生成
+// 引号、反斜杠、结构字符、空白、控制字符的位掩码，经前缀异或得到字符串内区间，
+// 一次性提取所有结构字符、字符串起点和标量起点的位置，同时拒绝字符串内未转义的控制字符
+// 和非法转义（保证之后 GetString 不会失败）；
+// 第二阶段线性校验语法并记录括号配对，之后的成员查找可直接跳过整个子容器。
+// 索引和解码后的字符串都分配在调用者提供的 Arena 中。
+class JsonDoc {
+public:
+	JsonDoc();
+
+	// 解析 [data, data + len)，缓冲区须在文档使用期间保持有效
+	bool Parse(const char *data, size_t len, Arena *arena);
+
+	void Clear();
+
+	// 根节点，解析失败时返回无效值
+	JsonValue Root() const;
+
+	// 当前选用的索引实现（"avx2" / "sse2" / "scalar"）
+	static const char *Impl();
+
+	static const int MAX_DEPTH = 512;
+
+private:
+	friend class JsonValue;
+
+	bool BuildIndex_();
+
+	bool Validate_();
+
+	bool ValidateScalar_(uint32_t pos) const;
+
+	// 字符串起始引号之后，找到对应的结束引号
+	const char *StringEnd_(uint32_t pos) const;
+
+	char At_(uint32_t idx) const { return data_[index_[idx]]; }
+
+	const char *data_;
+	size_t len_;
+	Arena *arena_;
+	uint32_t *index_;   // 结构索引：各 token 在原文中的偏移，末尾追加 len_ 作为哨兵
+	uint32_t count_;
+	uint32_t *match_;   // '{' / '[' 对应的结束括号下标
+	bool valid_;
+};
+
+template<class F>
+void JsonValue::ForEachMember(F &&f) const {
+	if (GetType() != OBJECT) { return; }
+	uint32_t j = idx_ + 1;
+	while (doc_->At_(j) != '}') {
+		JsonValue key(doc_, j);
+		JsonValue value(doc_, j + 2);
+		JsonString name;
+		if (!key.GetString(&name)) { return; }
+		f(name, value);
+		j = value.Next_();
+		if (doc_->At_(j) == ',') { j++; }
+	}
+}
+
+#endif //JSON_H
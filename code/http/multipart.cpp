@@ -0,0 +1,311 @@
+//
+// Created by moon on 25-3-20.
+//
+
+#include "multipart.h"
+#include <cstring>
+#include <stdlib.h>      // mkstemp
+#include <strings.h>     // strncasecmp
+#include <algorithm>
+
+size_t MultipartParser::maxPartSize = 32 * 1024 * 1024;
+size_t MultipartParser::maxFieldSize = 64 * 1024;
+size_t MultipartParser::maxParts = 64;
+std::string MultipartParser::uploadDir = "./upload";
+
+static const size_t MAX_PART_HEADER = 8192;
+static const size_t WRITE_BUF_SIZE = 64 * 1024;
+
+MultipartParser::MultipartParser() : state_(END), errCode_(400), fd_(-1), writeLen_(0) {}
+
+MultipartParser::~MultipartParser() {
+	Reset();
+}
+
+bool MultipartParser::Init(const std::string &contentType) {
+	Reset();
+	std::string boundary = HeaderParam_(contentType, "boundary");
+	if (boundary.empty() || boundary.size() > 70) {
+		LOG_ERROR("Multipart boundary error: %s", contentType.c_str());
+		return false;
+	}
+	delim_ = "\r\n--" + boundary;
+	size_t m = delim_.size();
+	for (size_t i = 0; i < 256; i++) { skip_[i] = m; }
+	for (size_t i = 0; i + 1 < m; i++) {
+		skip_[static_cast<unsigned char>(delim_[i])] = m - 1 - i;
+	}
+	/* 第一个分隔符前没有 CRLF，预置一个让所有分隔符形式一致 */
+	carry_ = "\r\n";
+	state_ = PREAMBLE;
+	return true;
+}
+
+void MultipartParser::Reset() {
+	if (fd_ >= 0) {
+		close(fd_);
+		fd_ = -1;
+	}
+	/* 请求结束：处理函数没有取走的文件（含未写完的）一律删除，上传不会在磁盘上累积 */
+	for (auto &part: parts_) {
+		if (!part.path.empty()) { unlink(part.path.c_str()); }
+	}
+	parts_.clear();
+	carry_.clear();
+	header_.clear();
+	writeLen_ = 0;
+	errCode_ = 400;
+	state_ = END;
+}
+
+std::string MultipartParser::TakeFile(size_t index) {
+	std::string path;
+	if (index < parts_.size() && !(index + 1 == parts_.size() && fd_ >= 0)) {
+		path.swap(parts_[index].path);
+	}
+	return path;
+}
+
+bool MultipartParser::Feed(const char *data, size_t len) {
+	if (state_ == FAILED) { return false; }
+	while (len > 0) {
+		if (!carry_.empty()) {
+			/* 暂存的前缀只需再补一个分隔符长度即可判定是否匹配 */
+			size_t take = std::min(len, delim_.size());
+			carry_.append(data, take);
+			data += take;
+			len -= take;
+			std::string window;
+			window.swap(carry_);
+			if (!Process_(window.data(), window.size())) { return false; }
+			continue;
+		}
+		return Process_(data, len);
+	}
+	return true;
+}
+
+bool MultipartParser::Process_(const char *p, size_t n) {
+	while (n > 0) {
+		switch (state_) {
+		case PREAMBLE: {
+			size_t pos = Search_(p, n);
+			if (pos == n) {
+				size_t keep = PartialMatch_(p, n);
+				carry_.assign(p + n - keep, keep);
+				return true;
+			}
+			p += pos + delim_.size();
+			n -= pos + delim_.size();
+			state_ = AFTER_DELIM;
+			break;
+		}
+		case AFTER_DELIM:
+			if (n < 2) {
+				carry_.assign(p, n);
+				return true;
+			}
+			if (p[0] == '-' && p[1] == '-') {
+				state_ = END;   // 结束分隔符之后的内容忽略
+				return true;
+			}
+			if (p[0] != '\r' || p[1] != '\n') { return Fail_(400); }
+			p += 2;
+			n -= 2;
+			header_ = "\r\n";
+			state_ = HEADERS;
+			break;
+		case HEADERS: {
+			size_t old = header_.size();
+			header_.append(p, std::min(n, MAX_PART_HEADER + 4 - old));
+			size_t pos = header_.find("\r\n\r\n", old >= 3 ? old - 3 : 0);
+			if (pos == std::string::npos) {
+				if (header_.size() > MAX_PART_HEADER) { return Fail_(400); }
+				return true;
+			}
+			size_t used = pos + 4 - old;
+			p += used;
+			n -= used;
+			header_.resize(pos + 2);
+			if (!BeginPart_()) { return false; }
+			state_ = DATA;
+			break;
+		}
+		case DATA: {
+			size_t pos = Search_(p, n);
+			if (pos == n) {
+				size_t keep = PartialMatch_(p, n);
+				if (!PartData_(p, n - keep)) { return false; }
+				carry_.assign(p + n - keep, keep);
+				return true;
+			}
+			if (!PartData_(p, pos) || !EndPart_()) { return false; }
+			p += pos + delim_.size();
+			n -= pos + delim_.size();
+			state_ = AFTER_DELIM;
+			break;
+		}
+		case END:
+			return true;
+		default:
+			return false;
+		}
+	}
+	return true;
+}
+
+// Boyer-Moore-Horspool：按窗口末字节查表跳跃，平均每次跳过接近一个分隔符长度
+size_t MultipartParser::Search_(const char *data, size_t len) const {
+	const size_t m = delim_.size();
+	if (len < m) { return len; }
+	const char last = delim_[m - 1];
+	size_t i = 0;
+	while (i <= len - m) {
+		char ch = data[i + m - 1];
+		if (ch == last && memcmp(data + i, delim_.data(), m - 1) == 0) {
+			return i;
+		}
+		i += skip_[static_cast<unsigned char>(ch)];
+	}
+	return len;
+}
+
+size_t MultipartParser::PartialMatch_(const char *data, size_t len) const {
+	for (size_t k = std::min(len, delim_.size() - 1); k > 0; k--) {
+		if (memcmp(data + len - k, delim_.data(), k) == 0) { return k; }
+	}
+	return 0;
+}
+
+bool MultipartParser::BeginPart_() {
+	if (parts_.size() >= maxParts) {
+		LOG_WARN("Too many multipart parts");
+		return Fail_(413);
+	}
+	parts_.emplace_back();
+	Part &part = parts_.back();
+	part.size = 0;
+
+	/* 逐行解析 part 头部，只关心 Content-Disposition 和 Content-Type */
+	size_t begin = 2;
+	while (begin < header_.size()) {
+		size_t end = header_.find("\r\n", begin);
+		std::string line = header_.substr(begin, end - begin);
+		begin = end + 2;
+		size_t colon = line.find(':');
+		if (colon == std::string::npos) { continue; }
+		size_t value = line.find_first_not_of(' ', colon + 1);
+		value = (value == std::string::npos) ? line.size() : value;
+		if (colon == 19 && strncasecmp(line.data(), "Content-Disposition", 19) == 0) {
+			part.name = HeaderParam_(line, "name");
+			part.filename = HeaderParam_(line, "filename");
+		} else if (colon == 12 && strncasecmp(line.data(), "Content-Type", 12) == 0) {
+			part.contentType = line.substr(value);
+		}
+	}
+
+	if (part.filename.empty()) { return true; }
+	mkdir(uploadDir.c_str(), 0755);
+	part.path = uploadDir + "/upload-XXXXXX";
+	fd_ = mkstemp(&part.path[0]);
+	if (fd_ < 0) {
+		LOG_ERROR("Create upload file in %s error: %d", uploadDir.c_str(), errno);
+		part.path.clear();
+		return Fail_(500);
+	}
+	writeBuf_.resize(WRITE_BUF_SIZE);
+	writeLen_ = 0;
+	LOG_DEBUG("Upload %s -> %s", part.filename.c_str(), part.path.c_str());
+	return true;
+}
+
+bool MultipartParser::PartData_(const char *data, size_t len) {
+	if (len == 0) { return true; }
+	Part &part = parts_.back();
+	part.size += len;
+	if (fd_ < 0) {
+		if (part.size > maxFieldSize) { return Fail_(413); }
+		part.value.append(data, len);
+		return true;
+	}
+	if (part.size > maxPartSize) {
+		LOG_WARN("Upload part %s too large", part.filename.c_str());
+		return Fail_(413);
+	}
+	/* 小块先聚合，攒满一整块再写；大块直接写，不经过聚合缓冲 */
+	if (writeLen_ + len > writeBuf_.size() && !FlushFile_()) { return false; }
+	if (len >= writeBuf_.size()) {
+		return WriteFile_(data, len);
+	}
+	memcpy(writeBuf_.data() + writeLen_, data, len);
+	writeLen_ += len;
+	return true;
+}
+
+bool MultipartParser::EndPart_() {
+	if (fd_ < 0) { return true; }
+	bool ok = FlushFile_();
+	close(fd_);
+	fd_ = -1;
+	return ok;
+}
+
+bool MultipartParser::FlushFile_() {
+	size_t len = writeLen_;
+	writeLen_ = 0;
+	return WriteFile_(writeBuf_.data(), len);
+}
+
+bool MultipartParser::WriteFile_(const char *data, size_t len) {
+	while (len > 0) {
+		ssize_t n = write(fd_, data, len);
+		if (n < 0) {
+			if (errno == EINTR) { continue; }
+			LOG_ERROR("Write upload file error: %d", errno);
+			return Fail_(500);
+		}
+		data += n;
+		len -= n;
+	}
+	return true;
+}
+
+bool MultipartParser::Fail_(int code) {
+	errCode_ = code;
+	if (fd_ >= 0) {
+		close(fd_);
+		fd_ = -1;
+	}
+	/* 请求被拒绝，已落盘的文件一并删除 */
+	for (auto &part: parts_) {
+		if (!part.path.empty()) { unlink(part.path.c_str()); }
+		part.path.clear();
+	}
+	state_ = FAILED;
+	return false;
+}
+
+// 取形如 `; key=value` 或 `; key="value"` 的参数值（key 大小写不敏感）
+std::string MultipartParser::HeaderParam_(const std::string &header, const char *key) {
+	size_t keyLen = strlen(key);
+	size_t pos = header.find(';');
+	while (pos != std::string::npos) {
+		size_t begin = header.find_first_not_of(' ', pos + 1);
+		if (begin == std::string::npos) { break; }
+		size_t next = header.find(';', begin);
+		if (header.size() - begin > keyLen && header[begin + keyLen] == '='
+		    && strncasecmp(header.data() + begin, key, keyLen) == 0) {
+			size_t valueBegin = begin + keyLen + 1;
+			if (valueBegin < header.size() && header[valueBegin] == '"') {
+				size_t quote = header.find('"', valueBegin + 1);
+				if (quote == std::string::npos) { return ""; }
+				return header.substr(valueBegin + 1, quote - valueBegin - 1);
+			}
+			size_t valueEnd = (next == std::string::npos) ? header.size() : next;
+			while (valueEnd > valueBegin && header[valueEnd - 1] == ' ') { valueEnd--; }
+			return header.substr(valueBegin, valueEnd - valueBegin);
+		}
+		pos = next;
+	}
+	return "";
+}
@@ -0,0 +1,107 @@
+//
+// Created by moon on 25-3-20.
+//
+
+#ifndef MULTIPART_H
+#define MULTIPART_H
+
+#include <string>
+#include <vector>
+#include <fcntl.h>       // open
+#include <unistd.h>      // write, close, unlink
+#include <sys/stat.h>    // mkdir
+#include <errno.h>
+
+#include "../log/log.h"
+
+// multipart/form-data 流式解析器
+// 请求体按块喂入 Feed()，用 Boyer-Moore-Horspool 在块内直接查找分隔符，
+// 只有可能跨块的分隔符前缀才会被暂存；文件内容经 64KB 聚合后整块写入磁盘，
+// 整个请求体不会在内存中缓存。单个 part 超过上限时立即拒绝。
+class MultipartParser {
+public:
+	struct Part {
+		std::string name;          // 表单字段名
+		std::string filename;      // 客户端文件名（普通字段为空）
+		std::string contentType;
+		std::string value;         // 普通字段的值
+		std::string path;          // 文件落盘路径（普通字段或已被取走时为空）
+		size_t size;
+	};
+
+	MultipartParser();
+
+	~MultipartParser();
+
+	// 开始解析新的请求体，从 Content-Type 中取 boundary，缺失时返回 false
+	bool Init(const std::string &contentType);
+
+	// 清空状态，删除所有未被 TakeFile 取走的落盘文件
+	void Reset();
+
+	// 取走第 index 个 part 的文件，之后由调用者负责（通常 rename 到最终位置）；不是文件 part 时返回空串
+	std::string TakeFile(size_t index);
+
+	// 喂入一块请求体，格式错误或超限时返回 false（见 ErrorCode）
+	bool Feed(const char *data, size_t len);
+
+	// 是否已读到结束分隔符
+	bool IsFinished() const { return state_ == END; }
+
+	// 出错时的 HTTP 状态码（400 / 413 / 500）
+	int ErrorCode() const { return errCode_; }
+
+	const std::vector<Part> &Parts() const { return parts_; }
+
+	static size_t maxPartSize;     // 单个文件 part 的最大字节数
+	static size_t maxFieldSize;    // 单个普通字段的最大字节数
+	static size_t maxParts;        // 一个请求中 part 的最大个数
+	static std::string uploadDir;  // 上传文件保存目录
+
+private:
+	enum STATE {
+		PREAMBLE,      // 查找第一个分隔符
+		AFTER_DELIM,   // 分隔符之后："\r\n" 开始新 part，"--" 表示结束
+		HEADERS,       // part 头部
+		DATA,          // part 内容
+		END,
+		FAILED,
+	};
+
+	// 处理一段连续数据，末尾可能是分隔符前缀的字节放入 carry_
+	bool Process_(const char *data, size_t len);
+
+	// 在 [data, data + len) 中查找分隔符，未找到返回 len
+	size_t Search_(const char *data, size_t len) const;
+
+	// 末尾与分隔符前缀相同的最长字节数
+	size_t PartialMatch_(const char *data, size_t len) const;
+
+	bool BeginPart_();
+
+	bool PartData_(const char *data, size_t len);
+
+	bool EndPart_();
+
+	bool FlushFile_();
+
+	bool WriteFile_(const char *data, size_t len);
+
+	bool Fail_(int code);
+
+	static std::string HeaderParam_(const std::string &header, const char *key);
+
+	STATE state_;
+	int errCode_;
+	std::string delim_;            // "\r\n--" + boundary
+	size_t skip_[256];             // BMH 坏字符跳转表
+	std::string carry_;            // 跨块暂存的分隔符前缀
+	std::string header_;           // 当前 part 的头部
+
+	std::vector<Part> parts_;
+	int fd_;                       // 当前文件 part 的描述符
+	std::vector<char> writeBuf_;   // 写盘聚合缓冲
+	size_t writeLen_;
+};
+
+#endif //MULTIPART_H
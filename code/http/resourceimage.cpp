@@ -0,0 +1,328 @@
+//
+// Created by moon on 25-3-23.
+//
+
+#include "resourceimage.h"
+#include <vector>
+#include <algorithm>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+
+#include "../log/log.h"
+#include "filecache.h"
+#include "gzipcache.h"
+#include "httpresponse.h"
+
+bool ResourceImage::useHugePages = true;
+size_t ResourceImage::maxFileSize = 16 * 1024 * 1024;
+size_t ResourceImage::maxBytes = 512 * 1024 * 1024;
+const uint32_t ResourceImage::EMPTY_SLOT;
+
+static const char IMAGE_MAGIC[8] = {'H', 'W', 'S', 'I', 'M', 'G', '\0', '\0'};
+static const size_t HUGE_PAGE_SIZE = 2 * 1024 * 1024;
+
+namespace {
+struct FileItem {
+	std::string path;       // 请求路径，以 '/' 开头
+	std::string file;       // 磁盘路径
+};
+
+// 递归收集可对外提供的普通文件（与 HttpResponse 的 403 判断一致：其他用户可读）
+void Walk(const std::string &dir, const std::string &prefix, std::vector<FileItem> *out) {
+	DIR *dp = opendir(dir.c_str());
+	if (!dp) { return; }
+	while (struct dirent *ent = readdir(dp)) {
+		if (ent->d_name[0] == '.') { continue; }
+		std::string file = dir + "/" + ent->d_name;
+		std::string path = prefix + "/" + ent->d_name;
+		struct stat st;
+		if (stat(file.c_str(), &st) < 0) { continue; }
+		if (S_ISDIR(st.st_mode)) {
+			Walk(file, path, out);
+		} else if (S_ISREG(st.st_mode) && (st.st_mode & S_IROTH)
+		           && static_cast<size_t>(st.st_size) <= ResourceImage::maxFileSize) {
+			out->push_back(FileItem{path, file});
+		}
+	}
+	closedir(dp);
+}
+
+bool ReadFile(const std::string &file, std::string *out) {
+	int fd = open(file.c_str(), O_RDONLY);
+	if (fd < 0) { return false; }
+	out->clear();
+	char buf[64 * 1024];
+	ssize_t n;
+	while ((n = read(fd, buf, sizeof(buf))) > 0) {
+		out->append(buf, n);
+	}
+	close(fd);
+	return n == 0;
+}
+
+size_t Align(std::string *out, size_t align) {
+	size_t off = (out->size() + align - 1) / align * align;
+	out->resize(off, '\0');
+	return off;
+}
+
+ResourceImage::Slice AppendSlice(std::string *out, const std::string &data) {
+	ResourceImage::Slice slice = {out->size(), data.size()};
+	out->append(data);
+	return slice;
+}
+}
+
+ResourceImage *ResourceImage::Instance() {
+	static ResourceImage image;
+	return &image;
+}
+
+ResourceImage::ResourceImage()
+		: base_(nullptr), size_(0), mapSize_(0), header_(nullptr), disp_(nullptr), slots_(nullptr),
+		  entries_(nullptr) {}
+
+ResourceImage::~ResourceImage() {
+	Unload();
+}
+
+uint64_t ResourceImage::Hash_(const char *data, size_t len, uint64_t seed) {
+	/* FNV-1a 加末尾混合，seed 用于完美哈希的位移 */
+	uint64_t h = 14695981039346656037ULL ^ (seed * 0x9E3779B97F4A7C15ULL);
+	for (size_t i = 0; i < len; i++) {
+		h ^= static_cast<unsigned char>(data[i]);
+		h *= 1099511628211ULL;
+	}
+	h ^= h >> 33;
+	h *= 0xff51afd7ed558ccdULL;
+	h ^= h >> 33;
+	return h;
+}
+
+bool ResourceImage::Serialize(const std::string &srcDir, std::string *out) {
+	std::string root = srcDir;
+	while (root.size() > 1 && root.back() == '/') { root.pop_back(); }
+	std::vector<FileItem> items;
+	Walk(root, "", &items);
+	if (items.size() >= EMPTY_SLOT / 2) { return false; }
+	const uint32_t count = items.size();
+
+	/* 完美哈希（hash and displace）：按一级哈希分桶，从大桶开始
+	   为每个桶找一个位移种子，使桶内所有路径落到互不冲突的空槽 */
+	uint32_t buckets = count / 4 + 1;
+	uint32_t slots = count + count / 4 + 1;
+	std::vector<uint32_t> disp, slotTable;
+	bool done = false;
+	while (!done) {
+		std::vector<std::vector<uint32_t>> bucketKeys(buckets);
+		for (uint32_t i = 0; i < count; i++) {
+			bucketKeys[Hash_(items[i].path.data(), items[i].path.size(), 0) % buckets].push_back(i);
+		}
+		std::vector<uint32_t> order(buckets);
+		for (uint32_t b = 0; b < buckets; b++) { order[b] = b; }
+		std::sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) {
+			return bucketKeys[a].size() > bucketKeys[b].size();
+		});
+		disp.assign(buckets, 0);
+		slotTable.assign(slots, EMPTY_SLOT);
+		done = true;
+		std::vector<uint32_t> pos;
+		for (uint32_t b: order) {
+			const std::vector<uint32_t> &keys = bucketKeys[b];
+			if (keys.empty()) { break; }
+			bool placed = false;
+			for (uint32_t d = 1; d < (1u << 16) && !placed; d++) {
+				pos.clear();
+				for (uint32_t k: keys) {
+					uint32_t s = Hash_(items[k].path.data(), items[k].path.size(), d) % slots;
+					if (slotTable[s] != EMPTY_SLOT || std::find(pos.begin(), pos.end(), s) != pos.end()) { break; }
+					pos.push_back(s);
+				}
+				if (pos.size() == keys.size()) {
+					for (size_t j = 0; j < keys.size(); j++) { slotTable[pos[j]] = keys[j]; }
+					disp[b] = d;
+					placed = true;
+				}
+			}
+			if (!placed) {
+				done = false;   // 槽太挤，放大后重试
+				slots += slots / 4 + 1;
+				break;
+			}
+		}
+	}
+
+	/* 布局：Header | 位移表 | 槽表 | 条目表 | 路径、缓存头 | 对齐的响应体 */
+	out->assign(sizeof(Header), '\0');
+	Header header = {};
+	memcpy(header.magic, IMAGE_MAGIC, sizeof(header.magic));
+	header.version = VERSION;
+	header.count = count;
+	header.buckets = buckets;
+	header.slots = slots;
+	header.dispOff = Align(out, 8);
+	out->append(reinterpret_cast<const char *>(disp.data()), buckets * sizeof(uint32_t));
+	header.slotOff = Align(out, 8);
+	out->append(reinterpret_cast<const char *>(slotTable.data()), slots * sizeof(uint32_t));
+	header.entryOff = Align(out, 8);
+	out->resize(out->size() + count * sizeof(Entry), '\0');
+
+	std::vector<Entry> entries(count);
+	std::string content, gzip;
+	FileCache::Entry info;
+	for (uint32_t i = 0; i < count; i++) {
+		const FileItem &item = items[i];
+		Entry &entry = entries[i];
+		memset(&entry, 0, sizeof(entry));
+		if (!FileCache::Instance()->Lookup(item.file, &info) || !ReadFile(item.file, &content)
+		    || content.size() != static_cast<size_t>(info.st.st_size)) {
+			LOG_ERROR("ResourceImage: read %s failed", item.file.c_str());
+			return false;
+		}
+		std::string suffix;
+		size_t dot = item.path.find_last_of('.');
+		if (dot != std::string::npos) { suffix = item.path.substr(dot); }
+
+		entry.path = AppendSlice(out, item.path);
+		entry.mtime = info.st.st_mtime;
+		Variant &identity = entry.variants[IDENTITY];
+		identity.etag = AppendSlice(out, info.etag);
+		identity.headers = AppendSlice(out, HttpResponse::CacheHeaders(info, suffix));
+		identity.body.off = Align(out, PAYLOAD_ALIGN);
+		identity.body.len = content.size();
+		out->append(content);
+
+		if (HttpResponse::IsCompressible(suffix) && content.size() >= HttpResponse::minCompressSize
+		    && GzipCache::Compress(content.data(), content.size(), &gzip) && gzip.size() < content.size()) {
+			Variant &variant = entry.variants[GZIP];
+			info.etag.insert(info.etag.size() - 1, "-gz");
+			variant.etag = AppendSlice(out, info.etag);
+			variant.headers = AppendSlice(out, HttpResponse::CacheHeaders(info, suffix));
+			variant.body.off = Align(out, PAYLOAD_ALIGN);
+			variant.body.len = gzip.size();
+			out->append(gzip);
+		}
+		if (out->size() > maxBytes) {
+			LOG_ERROR("ResourceImage: exceeds %zu bytes", maxBytes);
+			return false;
+		}
+	}
+	header.size = out->size();
+	memcpy(&(*out)[0], &header, sizeof(header));
+	if (count) { memcpy(&(*out)[header.entryOff], entries.data(), count * sizeof(Entry)); }
+	return true;
+}
+
+bool ResourceImage::Build(const std::string &srcDir) {
+	std::string image;
+	if (!Serialize(srcDir, &image)) { return false; }
+	Unload();
+
+	/* 优先显式大页，不可用时退回普通页并建议透明大页 */
+	void *mem = MAP_FAILED;
+	size_t mapSize = (image.size() + HUGE_PAGE_SIZE - 1) / HUGE_PAGE_SIZE * HUGE_PAGE_SIZE;
+	if (useHugePages) {
+		mem = mmap(nullptr, mapSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+	}
+	if (mem == MAP_FAILED) {
+		size_t page = sysconf(_SC_PAGESIZE);
+		mapSize = (image.size() + page - 1) / page * page;
+		mem = mmap(nullptr, mapSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		if (mem == MAP_FAILED) {
+			LOG_ERROR("ResourceImage: mmap %zu bytes failed", mapSize);
+			return false;
+		}
+		if (useHugePages) { madvise(mem, mapSize, MADV_HUGEPAGE); }
+	}
+	memcpy(mem, image.data(), image.size());
+	mprotect(mem, mapSize, PROT_READ);
+	mapSize_ = mapSize;
+	if (!Attach_(static_cast<const char *>(mem), image.size())) {
+		Unload();
+		return false;
+	}
+	LOG_INFO("ResourceImage: %zu files, %zu bytes", Count(), size_);
+	return true;
+}
+
+bool ResourceImage::Load(const std::string &file) {
+	int fd = open(file.c_str(), O_RDONLY);
+	if (fd < 0) { return false; }
+	struct stat st;
+	if (fstat(fd, &st) < 0 || st.st_size < static_cast<off_t>(sizeof(Header))) {
+		close(fd);
+		return false;
+	}
+	/* 共享映射：多个服务进程共用同一份页缓存 */
+	void *mem = mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED | MAP_POPULATE, fd, 0);
+	close(fd);
+	if (mem == MAP_FAILED) { return false; }
+	Unload();
+	mapSize_ = st.st_size;
+	if (!Attach_(static_cast<const char *>(mem), st.st_size)) {
+		LOG_ERROR("ResourceImage: %s is not a valid archive", file.c_str());
+		Unload();
+		return false;
+	}
+	LOG_INFO("ResourceImage: %s, %zu files, %zu bytes", file.c_str(), Count(), size_);
+	return true;
+}
+
+bool ResourceImage::Attach_(const char *base, size_t size) {
+	base_ = base;
+	size_ = size;
+	const Header *header = reinterpret_cast<const Header *>(base);
+	if (size < sizeof(Header) || memcmp(header->magic, IMAGE_MAGIC, sizeof(IMAGE_MAGIC)) != 0
+	    || header->version != VERSION || header->size != size || header->buckets == 0 || header->slots == 0
+	    || header->dispOff + header->buckets * sizeof(uint32_t) > size
+	    || header->slotOff + header->slots * sizeof(uint32_t) > size
+	    || header->entryOff + header->count * sizeof(Entry) > size) {
+		return false;
+	}
+	const Entry *entries = reinterpret_cast<const Entry *>(base + header->entryOff);
+	auto inside = [size](const Slice &slice) { return slice.off <= size && slice.len <= size - slice.off; };
+	for (uint32_t i = 0; i < header->count; i++) {
+		if (!inside(entries[i].path)) { return false; }
+		for (const Variant &variant: entries[i].variants) {
+			if (!inside(variant.headers) || !inside(variant.etag) || !inside(variant.body)) { return false; }
+		}
+	}
+	const uint32_t *slots = reinterpret_cast<const uint32_t *>(base + header->slotOff);
+	for (uint32_t i = 0; i < header->slots; i++) {
+		if (slots[i] != EMPTY_SLOT && slots[i] >= header->count) { return false; }
+	}
+	header_ = header;
+	disp_ = reinterpret_cast<const uint32_t *>(base + header->dispOff);
+	slots_ = slots;
+	entries_ = entries;
+	return true;
+}
+
+void ResourceImage::Unload() {
+	if (base_) {
+		munmap(const_cast<char *>(base_), mapSize_);
+	}
+	base_ = nullptr;
+	size_ = mapSize_ = 0;
+	header_ = nullptr;
+	disp_ = slots_ = nullptr;
+	entries_ = nullptr;
+}
+
+const ResourceImage::Entry *ResourceImage::Find(const char *path, size_t len) const {
+	if (!header_ || header_->count == 0) { return nullptr; }
+	uint32_t d = disp_[Hash_(path, len, 0) % header_->buckets];
+	uint32_t idx = slots_[Hash_(path, len, d) % header_->slots];
+	if (idx == EMPTY_SLOT) { return nullptr; }
+	const Entry *entry = &entries_[idx];
+	if (entry->path.len != len || memcmp(base_ + entry->path.off, path, len) != 0) { return nullptr; }
+	return entry;
+}
+
+size_t ResourceImage::Count() const {
+	return header_ ? header_->count : 0;
+}
@@ -0,0 +1,109 @@
+//
+// Created by moon on 25-3-23.
+//
+
+#ifndef RESOURCE_IMAGE_H
+#define RESOURCE_IMAGE_H
+
+#include <string>
+#include <cstdint>
+#include <cstddef>
+
+// 静态资源镜像
+// 把整个资源目录装进一段连续的只读内存（可用大页），按请求路径经完美哈希
+// 找到条目，直接得到预先生成的缓存头和响应体片段，请求期间不访问文件系统。
+// 镜像既可在启动时由目录构建（Build），也可由打包好的归档文件映射（Load），
+// 两者格式相同；所有偏移都相对镜像起始地址。
+class ResourceImage {
+public:
+	// 镜像内的一段字节
+	struct Slice {
+		uint64_t off;
+		uint64_t len;
+	};
+
+	enum VariantId {
+		IDENTITY = 0,
+		GZIP,
+		VARIANT_COUNT,
+	};
+
+	// 同一资源的一种编码表示
+	struct Variant {
+		Slice headers;      // ETag / Last-Modified / Cache-Control / Vary 等缓存头
+		Slice etag;
+		Slice body;         // 按 PAYLOAD_ALIGN 对齐，len 为 0 表示没有该表示
+	};
+
+	struct Entry {
+		Slice path;
+		int64_t mtime;
+		Variant variants[VARIANT_COUNT];
+	};
+
+	static ResourceImage *Instance();
+
+	// 遍历 srcDir 构建镜像并装入只读内存
+	bool Build(const std::string &srcDir);
+
+	// 映射打包好的归档文件
+	bool Load(const std::string &file);
+
+	// 遍历 srcDir 生成镜像字节（Build 与打包工具共用）
+	static bool Serialize(const std::string &srcDir, std::string *out);
+
+	void Unload();
+
+	bool IsLoaded() const { return base_ != nullptr; }
+
+	// 按路径查找条目，未收录返回 nullptr；两次哈希加一次比较
+	const Entry *Find(const char *path, size_t len) const;
+
+	const Entry *Find(const std::string &path) const { return Find(path.data(), path.size()); }
+
+	const char *Data(const Slice &slice) const { return base_ + slice.off; }
+
+	size_t Count() const;
+
+	size_t Size() const { return size_; }
+
+	static bool useHugePages;      // 构建时优先使用大页
+	static size_t maxFileSize;     // 超过该大小的文件不收录，仍走文件系统
+	static size_t maxBytes;        // 镜像总大小上限
+
+	static const size_t PAYLOAD_ALIGN = 64;
+
+private:
+	struct Header {
+		char magic[8];
+		uint32_t version;
+		uint32_t count;       // 条目数
+		uint32_t buckets;     // 一级桶数，每桶一个位移种子
+		uint32_t slots;       // 二级槽数
+		uint64_t dispOff;     // uint32_t[buckets]
+		uint64_t slotOff;     // uint32_t[slots]，条目下标或 EMPTY_SLOT
+		uint64_t entryOff;    // Entry[count]
+		uint64_t size;        // 镜像总字节数
+	};
+
+	ResourceImage();
+
+	~ResourceImage();
+
+	bool Attach_(const char *base, size_t size);
+
+	static uint64_t Hash_(const char *data, size_t len, uint64_t seed);
+
+	static const uint32_t VERSION = 1;
+	static const uint32_t EMPTY_SLOT = UINT32_MAX;
+
+	const char *base_;
+	size_t size_;
+	size_t mapSize_;
+	const Header *header_;
+	const uint32_t *disp_;
+	const uint32_t *slots_;
+	const Entry *entries_;
+};
+
+#endif //RESOURCE_IMAGE_H
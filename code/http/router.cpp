@@ -0,0 +1,192 @@
+//
+// Created by moon on 25-3-22.
+//
+
+#include "router.h"
+#include "../log/log.h"
+
+Router *Router::Instance() {
+	static Router router;
+	return &router;
+}
+
+Router::Router() : root_(new Node) {}
+
+bool Router::AddRewrite(Method method, const std::string &pattern, const std::string &target) {
+	return Insert_(method, pattern, Route{STATIC, target, nullptr, nullptr, false});
+}
+
+bool Router::Add(Method method, const std::string &pattern, HandlerType type, Handler handler,
+                 ChunkHandler chunkHandler) {
+	return Insert_(method, pattern, Route{type, "", std::move(handler), std::move(chunkHandler), false});
+}
+
+bool Router::AddUpload(Method method, const std::string &pattern, HandlerType type, Handler handler) {
+	return Insert_(method, pattern, Route{type, "", std::move(handler), nullptr, true});
+}
+
+void Router::Clear() {
+	root_.reset(new Node);
+}
+
+int Router::ParseMethod(const std::string &method) {
+	static const char *const NAMES[METHOD_COUNT] = {
+		"GET", "POST", "HEAD", "PUT", "DELETE", "PATCH", "OPTIONS",
+	};
+	for (int i = 0; i < METHOD_COUNT; i++) {
+		if (method == NAMES[i]) { return i; }
+	}
+	return -1;
+}
+
+bool Router::Insert_(Method method, const std::string &pattern, Route route) {
+	if (pattern.empty() || pattern[0] != '/') {
+		LOG_ERROR("Route %s: pattern must start with '/'", pattern.c_str());
+		return false;
+	}
+	Node *node = InsertPath_(pattern);
+	if (!node) { return false; }
+	if (method != ANY) {
+		if (node->routes[method] && !node->fromAny[method]) {
+			LOG_ERROR("Route %s registered twice", pattern.c_str());
+			return false;
+		}
+		node->routes[method].reset(new Route(std::move(route)));
+		node->fromAny[method] = false;
+		return true;
+	}
+	/* ANY 只填充尚未单独注册的方法 */
+	for (int m = 0; m < METHOD_COUNT; m++) {
+		if (node->routes[m] && node->fromAny[m]) {
+			LOG_ERROR("Route %s registered twice", pattern.c_str());
+			return false;
+		}
+	}
+	for (int m = 0; m < METHOD_COUNT; m++) {
+		if (!node->routes[m]) {
+			node->routes[m].reset(new Route(route));
+			node->fromAny[m] = true;
+		}
+	}
+	return true;
+}
+
+Router::Node *Router::InsertPath_(const std::string &pattern) {
+	Node *node = root_.get();
+	size_t pos = 0;
+	while (pos < pattern.size()) {
+		char ch = pattern[pos];
+		if (ch == ':') {
+			size_t end = pattern.find('/', pos);
+			if (end == std::string::npos) { end = pattern.size(); }
+			std::string name = pattern.substr(pos + 1, end - pos - 1);
+			if (name.empty()) {
+				LOG_ERROR("Route %s: empty parameter name", pattern.c_str());
+				return nullptr;
+			}
+			if (!node->param) {
+				node->param.reset(new Node);
+				node->paramName = name;
+			} else if (node->paramName != name) {
+				LOG_ERROR("Route %s: parameter :%s conflicts with :%s", pattern.c_str(), name.c_str(),
+				          node->paramName.c_str());
+				return nullptr;
+			}
+			node = node->param.get();
+			pos = end;
+			continue;
+		}
+		if (ch == '*') {
+			std::string name = pattern.substr(pos + 1);
+			if (name.empty() || name.find('/') != std::string::npos) {
+				LOG_ERROR("Route %s: wildcard must be the last segment", pattern.c_str());
+				return nullptr;
+			}
+			if (!node->wildcard) {
+				node->wildcard.reset(new Node);
+				node->wildcardName = name;
+			} else if (node->wildcardName != name) {
+				LOG_ERROR("Route %s: wildcard *%s conflicts with *%s", pattern.c_str(), name.c_str(),
+				          node->wildcardName.c_str());
+				return nullptr;
+			}
+			return node->wildcard.get();
+		}
+
+		/* 静态片段：与首字符相同的子节点求公共前缀，不完全匹配时拆分该子节点 */
+		size_t end = pattern.find_first_of(":*", pos);
+		if (end == std::string::npos) { end = pattern.size(); }
+		size_t idx = node->indices.find(ch);
+		if (idx == std::string::npos) {
+			std::unique_ptr<Node> child(new Node);
+			child->prefix = pattern.substr(pos, end - pos);
+			node->indices.push_back(ch);
+			node->children.push_back(std::move(child));
+			node = node->children.back().get();
+			pos = end;
+			continue;
+		}
+		Node *child = node->children[idx].get();
+		size_t n = 0;
+		while (n < child->prefix.size() && pos + n < end && child->prefix[n] == pattern[pos + n]) { n++; }
+		if (n < child->prefix.size()) {
+			std::unique_ptr<Node> mid(new Node);
+			mid->prefix = child->prefix.substr(0, n);
+			child->prefix.erase(0, n);
+			mid->indices.push_back(child->prefix[0]);
+			mid->children.push_back(std::move(node->children[idx]));
+			node->children[idx] = std::move(mid);
+			child = node->children[idx].get();
+		}
+		node = child;
+		pos += n;
+	}
+	return node;
+}
+
+const Router::Route *Router::Match(const std::string &method, const std::string &path, Params *params) const {
+	int m = ParseMethod(method);
+	if (m < 0) { return nullptr; }
+	params->count = 0;
+	const Node *node = Match_(root_.get(), path.data(), path.size(), 0, m, params);
+	if (!node && m == HEAD) {
+		m = GET;
+		params->count = 0;
+		node = Match_(root_.get(), path.data(), path.size(), 0, m, params);
+	}
+	return node ? node->routes[m].get() : nullptr;
+}
+
+const Router::Node *Router::Match_(const Node *node, const char *path, size_t len, size_t pos, int method,
+                                   Params *params) const {
+	if (pos == len) {
+		return node->routes[method] ? node : nullptr;
+	}
+	/* 静态子节点 */
+	size_t idx = node->indices.find(path[pos]);
+	if (idx != std::string::npos) {
+		const Node *child = node->children[idx].get();
+		size_t n = child->prefix.size();
+		if (len - pos >= n && memcmp(path + pos, child->prefix.data(), n) == 0) {
+			const Node *found = Match_(child, path, len, pos + n, method, params);
+			if (found) { return found; }
+		}
+	}
+	/* 参数：匹配到下一个 '/' 为止的非空片段 */
+	if (node->param && params->count < Params::MAX) {
+		const char *slash = static_cast<const char *>(memchr(path + pos, '/', len - pos));
+		size_t end = slash ? slash - path : len;
+		if (end > pos) {
+			params->items[params->count++] = Param{node->paramName.c_str(), path + pos, end - pos};
+			const Node *found = Match_(node->param.get(), path, len, end, method, params);
+			if (found) { return found; }
+			params->count--;
+		}
+	}
+	/* 通配：剩余全部 */
+	if (node->wildcard && node->wildcard->routes[method] && params->count < Params::MAX) {
+		params->items[params->count++] = Param{node->wildcardName.c_str(), path + pos, len - pos};
+		return node->wildcard.get();
+	}
+	return nullptr;
+}
@@ -0,0 +1,126 @@
+//
+// Created by moon on 25-3-22.
+//
+
+#ifndef ROUTER_H
+#define ROUTER_H
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <functional>
+#include <cstring>
+
+class HttpRequest;
+
+// 路由表：基数树（radix trie），按 方法 + 路径 匹配到静态文件改写或处理函数
+// 模式中 ":name" 匹配一段路径，"*name" 匹配剩余全部（只能在末尾），
+// 静态前缀优先于参数、参数优先于通配。
+// 启动阶段注册，运行期只读，匹配复杂度与路径长度成正比，不分配内存。
+class Router {
+public:
+	enum Method {
+		GET = 0,
+		POST,
+		HEAD,
+		PUT,
+		DELETE,
+		PATCH,
+		OPTIONS,
+		METHOD_COUNT,
+		ANY = METHOD_COUNT,   // 注册时表示其余所有方法，单独注册的方法优先
+	};
+
+	// 处理函数的执行性质，供调度选择线程
+	enum HandlerType {
+		STATIC,     // 静态文件（可带路径改写），无处理函数
+		CPU,        // 纯计算
+		BLOCKING,   // 可能阻塞（数据库、磁盘等）
+	};
+
+	// 路径参数，值指向匹配时传入的路径
+	struct Param {
+		const char *name;
+		const char *value;
+		size_t len;
+	};
+
+	struct Params {
+		static const size_t MAX = 8;
+
+		Param items[MAX];
+		size_t count = 0;
+
+		// 按名字取参数，不存在返回 nullptr
+		const Param *Find(const char *name) const {
+			for (size_t i = 0; i < count; i++) {
+				if (strcmp(items[i].name, name) == 0) { return &items[i]; }
+			}
+			return nullptr;
+		}
+	};
+
+	typedef std::function<void(HttpRequest &request, const Params &params)> Handler;
+
+	// 请求体分块处理函数：匹配到路由后，请求体按到达顺序直接交给它，不在内存或临时文件中保存；
+	// 在解析线程上调用，不应阻塞。返回 false 拒绝该请求体（响应 413）
+	typedef std::function<bool(HttpRequest &request, const Params &params, const char *data, size_t len)>
+		ChunkHandler;
+
+	struct Route {
+		HandlerType type;
+		std::string rewrite;    // 非空时把请求路径改写为该文件
+		Handler handler;
+		ChunkHandler chunkHandler;
+		bool uploads;           // 解析 multipart/form-data 请求体并把文件 part 落盘，只有注册时声明的路由才会
+	};
+
+	static Router *Instance();
+
+	// 静态文件改写，如 /login -> /login.html
+	bool AddRewrite(Method method, const std::string &pattern, const std::string &target);
+
+	// 注册处理函数，模式冲突时返回 false；chunkHandler 非空时请求体流式交给它
+	bool Add(Method method, const std::string &pattern, HandlerType type, Handler handler,
+	         ChunkHandler chunkHandler = nullptr);
+
+	// 注册接收文件上传的处理函数：multipart 请求体边到达边解析，文件 part 写入 MultipartParser::uploadDir，
+	// 处理函数需用 HttpRequest::TakeUpload 取走要保留的文件，其余在请求结束时删除
+	bool AddUpload(Method method, const std::string &pattern, HandlerType type, Handler handler);
+
+	// 匹配路由，未命中返回 nullptr；HEAD 未单独注册时使用 GET 的路由
+	const Route *Match(const std::string &method, const std::string &path, Params *params) const;
+
+	void Clear();
+
+	// 方法名转枚举，未知方法返回 -1
+	static int ParseMethod(const std::string &method);
+
+private:
+	struct Node {
+		std::string prefix;                            // 本节点的静态片段
+		std::string indices;                           // 各静态子节点片段的首字符
+		std::vector<std::unique_ptr<Node>> children;
+		std::unique_ptr<Node> param;                   // ":name" 子节点
+		std::string paramName;
+		std::unique_ptr<Node> wildcard;                // "*name" 子节点
+		std::string wildcardName;
+		std::unique_ptr<Route> routes[METHOD_COUNT];
+		bool fromAny[METHOD_COUNT] = {};               // 该方法的路由来自 ANY，可被单独注册覆盖
+	};
+
+	Router();
+
+	~Router() = default;
+
+	bool Insert_(Method method, const std::string &pattern, Route route);
+
+	Node *InsertPath_(const std::string &pattern);
+
+	const Node *Match_(const Node *node, const char *path, size_t len, size_t pos, int method,
+	                   Params *params) const;
+
+	std::unique_ptr<Node> root_;
+};
+
+#endif //ROUTER_H
@@ -0,0 +1,95 @@
+//
+// Created by moon on 25-3-19.
+//
+
+#include "scanner.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+#if defined(__ARM_NEON) || defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
+const char *Scanner::FindCRLF(const char *begin, const char *end) {
+	const char *p = begin;
+	while (p < end) {
+		p = Select_().findChar(p, end, '\r');
+		if (p + 1 >= end) { return end; }   // 没有 '\r' 或 '\r' 是最后一个字节（行不完整）
+		if (p[1] == '\n') { return p; }
+		p++;
+	}
+	return end;
+}
+
+const char *Scanner::FindChar(const char *begin, const char *end, char ch) {
+	return Select_().findChar(begin, end, ch);
+}
+
+const char *Scanner::Impl() {
+	return Select_().name;
+}
+
+// 首次调用时检测 CPU 能力并固定实现（局部静态变量初始化是线程安全的）
+const Scanner::Dispatch &Scanner::Select_() {
+	static const Dispatch dispatch = [] {
+#if defined(__x86_64__) || defined(__i386__)
+		__builtin_cpu_init();
+		if (__builtin_cpu_supports("avx2")) { return Dispatch{FindCharAvx2_, "avx2"}; }
+		if (__builtin_cpu_supports("sse2")) { return Dispatch{FindCharSse2_, "sse2"}; }
+#endif
+#if defined(__ARM_NEON) || defined(__aarch64__)
+		return Dispatch{FindCharNeon_, "neon"};
+#endif
+		return Dispatch{FindCharScalar_, "scalar"};
+	}();
+	return dispatch;
+}
+
+const char *Scanner::FindCharScalar_(const char *begin, const char *end, char ch) {
+	for (; begin < end; begin++) {
+		if (*begin == ch) { return begin; }
+	}
+	return end;
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+/* 单字节查找用 SSE2 的 pcmpeqb + pmovmskb 即可，比 SSE4.2 的 pcmpestri 延迟更低 */
+__attribute__((target("sse2")))
+const char *Scanner::FindCharSse2_(const char *begin, const char *end, char ch) {
+	const __m128i needle = _mm_set1_epi8(ch);
+	const char *p = begin;
+	for (; p + 16 <= end; p += 16) {
+		__m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+		int mask = _mm_movemask_epi8(_mm_cmpeq_epi8(block, needle));
+		if (mask) { return p + __builtin_ctz(mask); }
+	}
+	return FindCharScalar_(p, end, ch);
+}
+
+__attribute__((target("avx2")))
+const char *Scanner::FindCharAvx2_(const char *begin, const char *end, char ch) {
+	const __m256i needle = _mm256_set1_epi8(ch);
+	const char *p = begin;
+	for (; p + 32 <= end; p += 32) {
+		__m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p));
+		unsigned mask = static_cast<unsigned>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(block, needle)));
+		if (mask) { return p + __builtin_ctz(mask); }
+	}
+	return FindCharSse2_(p, end, ch);
+}
+#endif
+
+#if defined(__ARM_NEON) || defined(__aarch64__)
+const char *Scanner::FindCharNeon_(const char *begin, const char *end, char ch) {
+	const uint8x16_t needle = vdupq_n_u8(static_cast<uint8_t>(ch));
+	const char *p = begin;
+	for (; p + 16 <= end; p += 16) {
+		uint8x16_t eq = vceqq_u8(vld1q_u8(reinterpret_cast<const uint8_t *>(p)), needle);
+		// 把每字节 0x00/0xFF 压成每字节 4 位的 64 位掩码
+		uint64_t mask = vget_lane_u64(vreinterpret_u64_u8(vshrn_n_u16(vreinterpretq_u16_u8(eq), 4)), 0);
+		if (mask) { return p + (__builtin_ctzll(mask) >> 2); }
+	}
+	return FindCharScalar_(p, end, ch);
+}
+#endif
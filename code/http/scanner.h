@@ -0,0 +1,44 @@
+//
+// Created by moon on 25-3-19.
+//
+
+#ifndef SCANNER_H
+#define SCANNER_H
+
+#include <cstddef>
+
+// 请求解析用的分隔符扫描器
+// 每次比较 16/32 字节（SSE2 / AVX2 / NEON），启动时按 CPU 能力选择实现，
+// 不支持时退回逐字节的标量实现。所有接口均在 [begin, end) 内查找，未找到返回 end。
+class Scanner {
+public:
+	// 查找行结束符 "\r\n" 的起始位置
+	static const char *FindCRLF(const char *begin, const char *end);
+
+	// 查找单个字符（用于 ':' 和 ' '）
+	static const char *FindChar(const char *begin, const char *end, char ch);
+
+	// 当前选用的实现名称（"avx2" / "sse2" / "neon" / "scalar"）
+	static const char *Impl();
+
+private:
+	typedef const char *(*FindCharFn)(const char *, const char *, char);
+
+	struct Dispatch {
+		FindCharFn findChar;
+		const char *name;
+	};
+
+	static const Dispatch &Select_();
+
+	static const char *FindCharScalar_(const char *begin, const char *end, char ch);
+#if defined(__x86_64__) || defined(__i386__)
+	static const char *FindCharSse2_(const char *begin, const char *end, char ch);
+	static const char *FindCharAvx2_(const char *begin, const char *end, char ch);
+#endif
+#if defined(__ARM_NEON) || defined(__aarch64__)
+	static const char *FindCharNeon_(const char *begin, const char *end, char ch);
+#endif
+};
+
+#endif //SCANNER_H
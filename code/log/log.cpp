@@ -144,11 +144,11 @@ void Logger::WriteLog(int level, const char *format, ...) {
         logBuffer_.Append("\n\0", 2);            // 添加换行符
 
         if (isAsyncMode_ && logQueue_ && !logQueue_->IsFull()) {  // 异步模式
-            logQueue_->Append(logBuffer_.ReadAllAsString());
+            logQueue_->Append(logBuffer_.ReadAllAsString());   // 取出时已清空
         } else {                                 // 同步模式
             fputs(logBuffer_.GetReadPointer(), logFile_);
+            logBuffer_.ResetReadWritePositions();            // 清空缓冲区
         }
-        logBuffer_.ResetReadWritePositions();                // 清空缓冲区
     }
 }
 
@@ -7,6 +7,9 @@ int main()
 	HttpServer server(
 		1316, 3, 60000, false,             /* 端口 ET模式 timeoutMs 优雅退出  */
 		3306, "root", "root", "webserver", /* Mysql配置 */
-		12, 6, true, 1, 1024);             /* 连接池数量 线程池数量 日志开关 日志等级 日志异步队列容量 */
+		12, 0, true, 1, 1024,              /* 连接池数量 线程池数量（0 按可用 CPU） 日志开关 日志等级 日志异步队列容量 */
+		false, nullptr, true, true,        /* 资源预加载到内存镜像 资源归档文件（make pack 生成） 静态请求内联处理 工作线程亲和 */
+		false, nullptr,                    /* 线程绑核 网卡名（按其 NUMA 节点和中断放置线程） */
+		0, 0, 256);                        /* 阻塞通道线程数（0 同连接池数量） CPU 通道队列上限（0 不限） 阻塞通道队列上限 */
 	server.Start();
 }
\ No newline at end of file
@@ -0,0 +1,141 @@
+//
+// Created by moon on 25-3-27.
+//
+
+#include "cputopology.h"
+#include <sched.h>       // sched_getaffinity
+#include <pthread.h>     // pthread_setaffinity_np
+#include <dirent.h>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cctype>
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+using namespace std;
+
+int CpuTopology::AvailableCpus() {
+    int cpus = static_cast<int>(AllowedCpus().size());
+    int quota = CgroupQuotaCpus_();
+    if(quota > 0 && quota < cpus) { cpus = quota; }
+    return max(cpus, 1);
+}
+
+vector<int> CpuTopology::AllowedCpus() {
+    vector<int> cpus;
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    if(sched_getaffinity(0, sizeof(set), &set) == 0) {
+        for(int i = 0; i < CPU_SETSIZE; i++) {
+            if(CPU_ISSET(i, &set)) { cpus.push_back(i); }
+        }
+    }
+    return cpus;
+}
+
+/* 先找本进程所在 cgroup 的配额，再找根目录（容器内通常挂载为自身 cgroup） */
+int CpuTopology::CgroupQuotaCpus_() {
+    string self, content;
+    if(ReadFile_("/proc/self/cgroup", &content)) {
+        istringstream lines(content);
+        string line;
+        while(getline(lines, line)) {
+            if(line.compare(0, 3, "0::") == 0) { self = line.substr(3); }
+        }
+    }
+    vector<string> dirs;
+    if(!self.empty() && self != "/") { dirs.push_back("/sys/fs/cgroup" + self); }
+    dirs.push_back("/sys/fs/cgroup");
+
+    /* cgroup v2：cpu.max 为 "配额 周期" 或 "max 周期" */
+    for(const string& dir: dirs) {
+        if(!ReadFile_(dir + "/cpu.max", &content)) { continue; }
+        long long quota = 0, period = 0;
+        if(sscanf(content.c_str(), "%lld %lld", &quota, &period) == 2 && quota > 0 && period > 0) {
+            return static_cast<int>((quota + period - 1) / period);
+        }
+        return 0;
+    }
+    /* cgroup v1 */
+    string quota, period;
+    if(ReadFile_("/sys/fs/cgroup/cpu/cpu.cfs_quota_us", &quota)
+       && ReadFile_("/sys/fs/cgroup/cpu/cpu.cfs_period_us", &period)) {
+        long long q = atoll(quota.c_str()), p = atoll(period.c_str());
+        if(q > 0 && p > 0) { return static_cast<int>((q + p - 1) / p); }
+    }
+    return 0;
+}
+
+int CpuTopology::NodeOfCpu(int cpu) {
+    string dir = "/sys/devices/system/cpu/cpu" + to_string(cpu);
+    DIR* d = opendir(dir.c_str());
+    if(!d) { return 0; }
+    int node = 0;
+    while(struct dirent* entry = readdir(d)) {
+        if(strncmp(entry->d_name, "node", 4) == 0 && isdigit(entry->d_name[4])) {
+            node = atoi(entry->d_name + 4);
+            break;
+        }
+    }
+    closedir(d);
+    return node;
+}
+
+int CpuTopology::NodeOfNic(const char* nic) {
+    string content;
+    if(!nic || !ReadFile_(string("/sys/class/net/") + nic + "/device/numa_node", &content)) { return -1; }
+    return atoi(content.c_str());
+}
+
+vector<int> CpuTopology::IrqCpus(const char* nic) {
+    vector<int> cpus;
+    string content;
+    if(!nic || !*nic || !ReadFile_("/proc/interrupts", &content)) { return cpus; }
+    istringstream lines(content);
+    string line;
+    while(getline(lines, line)) {
+        size_t begin = line.find_first_not_of(' ');
+        if(begin == string::npos || !isdigit(line[begin]) || line.find(nic) == string::npos) { continue; }
+        int irq = atoi(line.c_str() + begin);
+        string list;
+        if(!ReadFile_("/proc/irq/" + to_string(irq) + "/effective_affinity_list", &list)
+           && !ReadFile_("/proc/irq/" + to_string(irq) + "/smp_affinity_list", &list)) {
+            continue;
+        }
+        for(int cpu: ParseCpuList(list)) { cpus.push_back(cpu); }
+    }
+    sort(cpus.begin(), cpus.end());
+    cpus.erase(unique(cpus.begin(), cpus.end()), cpus.end());
+    return cpus;
+}
+
+bool CpuTopology::PinCurrentThread(int cpu) {
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+}
+
+vector<int> CpuTopology::ParseCpuList(const string& list) {
+    vector<int> cpus;
+    istringstream items(list);
+    string item;
+    while(getline(items, item, ',')) {
+        int first = 0, last = 0;
+        int n = sscanf(item.c_str(), "%d-%d", &first, &last);
+        if(n == 1) { last = first; }
+        else if(n != 2) { continue; }
+        for(int cpu = first; cpu <= last; cpu++) { cpus.push_back(cpu); }
+    }
+    return cpus;
+}
+
+bool CpuTopology::ReadFile_(const string& path, string* out) {
+    ifstream file(path);
+    if(!file) { return false; }
+    ostringstream content;
+    content << file.rdbuf();
+    *out = content.str();
+    return true;
+}
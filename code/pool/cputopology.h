@@ -0,0 +1,43 @@
+//
+// Created by moon on 25-3-27.
+//
+
+#ifndef CPU_TOPOLOGY_H
+#define CPU_TOPOLOGY_H
+
+#include <vector>
+#include <string>
+
+// CPU / NUMA 拓扑查询（读取 /proc 与 /sys，不依赖 libnuma）
+// 用于按可用 CPU 确定线程数，以及把 Reactor 和工作线程绑定到合适的核上。
+class CpuTopology {
+public:
+	// 本进程可用的 CPU 数：亲和掩码中的 CPU 数，再受 cgroup CPU 配额（v2 cpu.max / v1 cfs_quota）限制，至少为 1
+	static int AvailableCpus();
+
+	// 亲和掩码中的 CPU 编号（升序）
+	static std::vector<int> AllowedCpus();
+
+	// CPU 所在的 NUMA 节点，无 NUMA 信息时返回 0
+	static int NodeOfCpu(int cpu);
+
+	// 网卡所在的 NUMA 节点，未知时返回 -1
+	static int NodeOfNic(const char *nic);
+
+	// 正在处理该网卡中断的 CPU（/proc/interrupts 中名称含网卡名的中断，取其有效亲和）
+	static std::vector<int> IrqCpus(const char *nic);
+
+	// 把调用线程绑定到 cpu
+	static bool PinCurrentThread(int cpu);
+
+	// "0-3,8,10-11" -> {0,1,2,3,8,10,11}
+	static std::vector<int> ParseCpuList(const std::string &list);
+
+private:
+	// cgroup 配额折算的 CPU 数（向上取整），无限制时返回 0
+	static int CgroupQuotaCpus_();
+
+	static bool ReadFile_(const std::string &path, std::string *out);
+};
+
+#endif //CPU_TOPOLOGY_H
@@ -0,0 +1,196 @@
+//
+// Created by moon on 25-3-19.
+//
+
+#include "sqlbatchwriter.h"
+#include <unordered_map>
+#include <cctype>
+using namespace std;
+
+SqlBatchWriter::SqlBatchWriter() {
+    connPool_ = nullptr;
+    maxBatch_ = 64;
+    maxDelayMs_ = 2;
+    isClosed_ = true;
+}
+
+SqlBatchWriter::~SqlBatchWriter() {
+    Close();
+}
+
+SqlBatchWriter* SqlBatchWriter::Instance() {
+    static SqlBatchWriter writer;
+    return &writer;
+}
+
+void SqlBatchWriter::Init(SqlConnPool* connPool, size_t maxBatch, int maxDelayMs) {
+    assert(connPool && maxBatch > 0 && maxDelayMs >= 0);
+    lock_guard<mutex> locker(mtx_);
+    if(!isClosed_) { return; }
+    connPool_ = connPool;
+    maxBatch_ = maxBatch;
+    maxDelayMs_ = maxDelayMs;
+    isClosed_ = false;
+    writer_ = thread(&SqlBatchWriter::WriterLoop_, this);
+}
+
+void SqlBatchWriter::Close() {
+    {
+        lock_guard<mutex> locker(mtx_);
+        isClosed_ = true;
+    }
+    cond_.notify_all();
+    if(writer_.joinable()) {
+        writer_.join();
+    }
+}
+
+bool SqlBatchWriter::Register(const string& name, const string& pwd) {
+    Pending item;
+    item.name = name;
+    item.pwd = pwd;
+    future<bool> result = item.result.get_future();
+    {
+        lock_guard<mutex> locker(mtx_);
+        if(isClosed_) { return false; }
+        queue_.push_back(&item);
+    }
+    cond_.notify_one();
+    return result.get();
+}
+
+void SqlBatchWriter::WriterLoop_() {
+    vector<Pending*> batch;
+    batch.reserve(maxBatch_);
+    unique_lock<mutex> locker(mtx_);
+    while(true) {
+        if(queue_.empty()) {
+            if(isClosed_) { break; }
+            cond_.wait(locker);
+            continue;
+        }
+        /* 组提交窗口：首个请求到达后稍作等待，让并发的注册进入同一个事务 */
+        if(queue_.size() < maxBatch_ && maxDelayMs_ > 0 && !isClosed_) {
+            cond_.wait_for(locker, chrono::milliseconds(maxDelayMs_), [this] {
+                return queue_.size() >= maxBatch_ || isClosed_;
+            });
+        }
+        while(!queue_.empty() && batch.size() < maxBatch_) {
+            batch.push_back(queue_.front());
+            queue_.pop_front();
+        }
+        locker.unlock();
+        FlushBatch_(batch);
+        batch.clear();
+        locker.lock();
+    }
+}
+
+string SqlBatchWriter::Escape_(MYSQL* sql, const string& str) {
+    string escaped(str.size() * 2 + 1, '\0');
+    unsigned long len = mysql_real_escape_string(sql, &escaped[0], str.data(), str.size());
+    escaped.resize(len);
+    return escaped;
+}
+
+/* 只折叠 ASCII 字母；其余 general_ci 视为相同的字符（如重音字母）仍可能漏判，
+   那时整批回滚走逐条插入，结果仍然正确 */
+string SqlBatchWriter::FoldName_(const string& name) {
+    size_t len = name.find_last_not_of(' ');
+    len = (len == string::npos) ? 0 : len + 1;
+    string key(name, 0, len);
+    for(char& ch: key) { ch = tolower(static_cast<unsigned char>(ch)); }
+    return key;
+}
+
+void SqlBatchWriter::FlushBatch_(vector<Pending*>& batch) {
+    MYSQL* sql = connPool_->GetConn();
+    if(!sql) {
+        LOG_WARN("SqlBatchWriter: no connection, %d register(s) failed", (int)batch.size());
+        for(auto item: batch) { item->result.set_value(false); }
+        return;
+    }
+
+    /* 同一批内的重名注册只保留第一条，按列的排序规则判断重名 */
+    vector<Pending*> unique;
+    vector<string> names;
+    unordered_map<string, Pending*> byName;
+    unique.reserve(batch.size());
+    names.reserve(batch.size());
+    for(auto item: batch) {
+        string key = FoldName_(item->name);
+        if(byName.count(key)) {
+            item->result.set_value(false);
+            continue;
+        }
+        byName[key] = item;
+        unique.push_back(item);
+        names.push_back(Escape_(sql, item->name));
+    }
+
+    bool ok = (mysql_query(sql, "START TRANSACTION") == 0);
+
+    /* 一次查询找出已被占用的用户名 */
+    if(ok) {
+        string order = "SELECT username FROM user WHERE username IN (";
+        for(size_t i = 0; i < names.size(); i++) {
+            order += (i ? ",'" : "'") + names[i] + "'";
+        }
+        order += ") FOR UPDATE";
+        LOG_DEBUG("%s", order.c_str());
+        ok = (mysql_query(sql, order.c_str()) == 0);
+        MYSQL_RES* res = ok ? mysql_store_result(sql) : nullptr;
+        if(res) {
+            while(MYSQL_ROW row = mysql_fetch_row(res)) {
+                auto it = byName.find(FoldName_(row[0]));
+                if(it != byName.end() && it->second) {
+                    LOG_DEBUG("user used: %s", row[0]);
+                    it->second->result.set_value(false);
+                    it->second = nullptr;
+                }
+            }
+            mysql_free_result(res);
+        }
+    }
+
+    /* 剩余记录合并成一条多行 INSERT */
+    vector<Pending*> inserts;
+    if(ok) {
+        string order = "INSERT INTO user(username, password) VALUES";
+        for(size_t i = 0; i < unique.size(); i++) {
+            if(byName[FoldName_(unique[i]->name)] == nullptr) { continue; }
+            order += (inserts.empty() ? "('" : ",('") + names[i] + "','" + Escape_(sql, unique[i]->pwd) + "')";
+            inserts.push_back(unique[i]);
+        }
+        if(!inserts.empty()) {
+            LOG_DEBUG("%s", order.c_str());
+            ok = (mysql_query(sql, order.c_str()) == 0);
+        }
+    }
+
+    if(ok && mysql_query(sql, "COMMIT") == 0) {
+        LOG_DEBUG("SqlBatchWriter: %d register(s) committed", (int)inserts.size());
+        for(auto item: inserts) { item->result.set_value(true); }
+    } else {
+        /* 整批失败（如与其他进程的并发插入冲突），回滚后逐条重试 */
+        LOG_WARN("SqlBatchWriter: batch insert failed: %s", mysql_error(sql));
+        mysql_query(sql, "ROLLBACK");
+        vector<Pending*> rest;
+        for(auto item: unique) {
+            if(byName[FoldName_(item->name)] != nullptr) { rest.push_back(item); }
+        }
+        FlushOneByOne_(sql, rest);
+    }
+    connPool_->FreeConn(sql);
+}
+
+void SqlBatchWriter::FlushOneByOne_(MYSQL* sql, vector<Pending*>& batch) {
+    for(auto item: batch) {
+        string order = "INSERT INTO user(username, password) VALUES('" +
+                       Escape_(sql, item->name) + "','" + Escape_(sql, item->pwd) + "')";
+        LOG_DEBUG("%s", order.c_str());
+        bool ok = (mysql_query(sql, order.c_str()) == 0);
+        if(!ok) { LOG_DEBUG("Insert error!"); }
+        item->result.set_value(ok);
+    }
+}
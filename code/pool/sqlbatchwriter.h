@@ -0,0 +1,75 @@
+//
+// Created by moon on 25-3-19.
+//
+
+#ifndef SQLBATCHWRITER_H
+#define SQLBATCHWRITER_H
+
+#include <mysql/mysql.h>
+#include <string>
+#include <vector>
+#include <deque>
+#include <mutex>
+#include <condition_variable>
+#include <future>
+#include <thread>
+#include <chrono>
+#include "sqlconnpool.h"
+#include "../log/log.h"
+
+// 注册请求的组提交写入器：
+// 各工作线程把注册请求放入队列并等待结果，由唯一的写线程批量取出，
+// 在同一个事务中用一条多行 INSERT 完成写入，再逐一通知调用者。
+class SqlBatchWriter {
+public:
+	static SqlBatchWriter *Instance();
+
+	// 启动写线程
+	// 参数：connPool - 取连接的数据库连接池
+	//      maxBatch - 单个事务最多合并的注册数
+	//      maxDelayMs - 收到首个请求后等待更多请求加入同一批的最长时间
+	void Init(SqlConnPool *connPool, size_t maxBatch = 64, int maxDelayMs = 2);
+
+	// 提交一次注册并阻塞等待结果
+	// 返回：true 写入成功；false 用户名已被占用或写入失败
+	bool Register(const std::string &name, const std::string &pwd);
+
+	// 停止写线程（队列中剩余的请求仍会被处理完）
+	void Close();
+
+private:
+	SqlBatchWriter();
+	~SqlBatchWriter();
+
+	// 一条待写入的注册记录（对象位于调用者栈上，结果经 promise 返回）
+	struct Pending {
+		std::string name;
+		std::string pwd;
+		std::promise<bool> result;
+	};
+
+	// 写线程主循环
+	void WriterLoop_();
+	// 在一个事务内写入一批注册
+	void FlushBatch_(std::vector<Pending *> &batch);
+	// 批量写入失败时的回退：逐条插入以得到每条记录的准确结果
+	void FlushOneByOne_(MYSQL *sql, std::vector<Pending *> &batch);
+
+	static std::string Escape_(MYSQL *sql, const std::string &str);
+
+	// 按 username 列的排序规则（utf8_general_ci：不区分大小写、忽略末尾空格）折叠，
+	// 数据库认为相同的用户名得到相同的键
+	static std::string FoldName_(const std::string &name);
+
+	SqlConnPool *connPool_;
+	size_t maxBatch_;
+	int maxDelayMs_;
+	bool isClosed_;
+
+	std::deque<Pending *> queue_;
+	std::mutex mtx_;
+	std::condition_variable cond_;
+	std::thread writer_;
+};
+
+#endif //SQLBATCHWRITER_H
@@ -10,15 +10,38 @@
 #include <queue>
 #include <thread>
 #include <functional>
+#include <deque>
+#include <vector>
+#include <memory>
+#include <atomic>
 // 线程池类，用于管理多个工作线程并行处理任务
+// 亲和模式下每个工作线程有自己的队列：同一连接的任务按键固定派给同一线程，
+// 其连接状态留在该核的缓存中；只有当某线程正忙而它的队列仍有积压时，空闲线程才去窃取
 class ThreadPool {
 public:
+    // 每个工作线程启动时以自己的序号调用一次，用于绑核等线程级设置
+    typedef std::function<void(size_t)> StartHook;
+
     // 构造函数，默认创建8个线程
-    explicit ThreadPool(size_t threadCount = 8): pool_(std::make_shared<Pool>()/*make_shared用于创建共享指针*/) {
+    explicit ThreadPool(size_t threadCount = 8, bool affinity = false, StartHook onStart = nullptr)
+        : pool_(std::make_shared<Pool>()/*make_shared用于创建共享指针*/) {
             assert(threadCount > 0);  // 确保线程数合法
+            if(affinity) {
+                for(size_t i = 0; i < threadCount; i++) {
+                    pool_->workers.emplace_back(new Worker());
+                }
+                for(size_t i = 0; i < threadCount; i++) {
+                    std::thread([pool = pool_, i, onStart] {
+                        if(onStart) { onStart(i); }
+                        RunWorker_(pool, i);
+                    }).detach();
+                }
+                return;
+            }
             for(size_t i = 0; i < threadCount; i++) {
                 // 创建工作线程（立即detach，不等待线程结束）
-                std::thread([pool = pool_] {  // 捕获共享的Pool对象
+                std::thread([pool = pool_, i, onStart] {  // 捕获共享的Pool对象
+                    if(onStart) { onStart(i); }
                     std::unique_lock<std::mutex> locker(pool->mtx);
                     // 从线程池中获取互斥锁，其他线程获取时会被已经获取的某一线程阻塞
                     while(true) {  // 线程主循环
@@ -27,6 +50,7 @@ public:
                             auto task = std::move(pool->tasks.front());  // 提取任务
                             //std::move将左值转换成可被引用的右值
                             pool->tasks.pop();  // 移除已取出的任务
+                            pool->pending--;
                             locker.unlock();    // 释放锁，允许其他线程操作队列
                             task();             // 执行任务（无锁状态下执行）
                             locker.lock();      // 重新加锁准备下一次循环
@@ -54,27 +78,156 @@ public:
                 pool_->isClosed = true;  // 设置关闭标志（注意：isClosed未初始化）
             }
             pool_->cond.notify_all();  // 唤醒所有等待线程
+            for(auto& worker: pool_->workers) {
+                {
+                    std::lock_guard<std::mutex> locker(worker->mtx);
+                    worker->closed = true;
+                }
+                worker->cond.notify_all();
+            }
         }
     }
 
     // 添加任务到队列（支持完美转发）
     template<class F>
     void AddTask(F&& task) {
+        if(!pool_->workers.empty()) {
+            /* 亲和模式下无键任务轮流派发 */
+            AddTask(pool_->next++, std::forward<F>(task));
+            return;
+        }
         {
             std::lock_guard<std::mutex> locker(pool_->mtx);  // 加锁保护队列
             pool_->tasks.emplace(std::forward<F>(task));  // 将任务加入队列
+            pool_->pending++;
         }
         pool_->cond.notify_one();  // 唤醒一个等待线程
     }
 
+    // 按键（如连接 fd）派发到固定的工作线程；非亲和模式下等同于 AddTask(task)
+    template<class F>
+    void AddTask(size_t key, F&& task) {
+        if(pool_->workers.empty()) {
+            AddTask(std::forward<F>(task));
+            return;
+        }
+        size_t id = key % pool_->workers.size();
+        Worker& worker = *pool_->workers[id];
+        bool sleeping;
+        {
+            std::lock_guard<std::mutex> locker(worker.mtx);
+            worker.tasks.emplace_back(std::forward<F>(task));
+            pool_->pending++;
+            sleeping = worker.sleeping;
+        }
+        if(sleeping) {
+            worker.cond.notify_one();
+        } else {
+            WakeThief_(*pool_, id);  // 目标线程正忙，唤醒一个空闲线程来窃取
+        }
+    }
+
+    // 有界派发：排队（尚未开始执行）的任务数已达上限时不入队，返回 false 由调用者降级处理
+    template<class F>
+    bool TryAddTask(F&& task) {
+        if(Full()) { return false; }
+        AddTask(std::forward<F>(task));
+        return true;
+    }
+
+    template<class F>
+    bool TryAddTask(size_t key, F&& task) {
+        if(Full()) { return false; }
+        AddTask(key, std::forward<F>(task));
+        return true;
+    }
+
+    // 排队任务数上限，0 为不限（只约束 TryAddTask，上限是近似的）
+    void SetQueueLimit(size_t limit) { pool_->maxQueue = limit; }
+
+    bool Full() const { return pool_->maxQueue > 0 && pool_->pending >= pool_->maxQueue; }
+
 private:
+    // 亲和模式下每个工作线程的私有队列
+    struct Worker {
+        std::mutex mtx;
+        std::condition_variable cond;
+        std::deque<std::function<void()>> tasks;
+        bool sleeping = false;   // 正在等待新任务
+        bool closed = false;
+    };
+
+
     // 线程池共享的内部数据结构
     struct Pool {
         std::mutex mtx;                          // 互斥锁
         std::condition_variable cond;            // 条件变量
         bool isClosed;                           // 关闭标志（未初始化）
         std::queue<std::function<void()>> tasks; // 任务队列（存储可调用对象）
+        std::vector<std::unique_ptr<Worker>> workers;  // 亲和模式的各线程队列，为空时使用共享队列
+        std::atomic<size_t> next{0};
+        std::atomic<size_t> pending{0};   // 已入队尚未开始执行的任务数
+        size_t maxQueue = 0;
     };
+
+    static void RunWorker_(std::shared_ptr<Pool> pool, size_t id) {
+        Worker& self = *pool->workers[id];
+        std::function<void()> task;
+        std::unique_lock<std::mutex> locker(self.mtx);
+        while(true) {
+            if(!self.tasks.empty()) {
+                task = std::move(self.tasks.front());
+                self.tasks.pop_front();
+                pool->pending--;
+                locker.unlock();
+                task();
+                locker.lock();
+                continue;
+            }
+            locker.unlock();
+            bool stolen = Steal_(*pool, id, &task);
+            if(stolen) { task(); }
+            locker.lock();
+            if(stolen || !self.tasks.empty()) { continue; }
+            if(self.closed) { break; }
+            self.sleeping = true;
+            self.cond.wait(locker);
+            self.sleeping = false;
+        }
+    }
+
+    /* 只从正忙（未在等待）且有积压的线程队列尾部取任务，队首留给它自己按顺序处理 */
+    static bool Steal_(Pool& pool, size_t id, std::function<void()>* task) {
+        size_t n = pool.workers.size();
+        for(size_t i = 1; i < n; i++) {
+            Worker& victim = *pool.workers[(id + i) % n];
+            std::lock_guard<std::mutex> locker(victim.mtx);
+            if(!victim.sleeping && !victim.tasks.empty()) {
+                *task = std::move(victim.tasks.back());
+                victim.tasks.pop_back();
+                pool.pending--;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    static void WakeThief_(Pool& pool, size_t busy) {
+        size_t n = pool.workers.size();
+        for(size_t i = 1; i < n; i++) {
+            Worker& worker = *pool.workers[(busy + i) % n];
+            bool sleeping;
+            {
+                std::lock_guard<std::mutex> locker(worker.mtx);
+                sleeping = worker.sleeping;
+            }
+            if(sleeping) {
+                worker.cond.notify_one();
+                return;
+            }
+        }
+    }
+
     std::shared_ptr<Pool> pool_;  // 共享的Pool对象（允许多个ThreadPool实例共享状态）
 };
 #endif //THREADPOOL_H
@@ -0,0 +1,68 @@
+//
+// Created by moon on 25-3-24.
+//
+
+#include "completionqueue.h"
+#include <cassert>
+
+CompletionQueue::CompletionQueue()
+	: eventFd_(eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)),
+	  signaled_(false),
+	  head_(&stub_),
+	  tail_(&stub_) {
+	assert(eventFd_ >= 0);
+}
+
+CompletionQueue::~CompletionQueue() {
+	close(eventFd_);
+}
+
+void CompletionQueue::Link_(Node *node) {
+	node->next.store(nullptr, std::memory_order_relaxed);
+	Node *prev = head_.exchange(node, std::memory_order_acq_rel);
+	prev->next.store(node, std::memory_order_release);
+}
+
+void CompletionQueue::Push(Node *node) {
+	Link_(node);
+	/* 唤醒标记已置位说明 Reactor 尚未开始本轮处理，不必重复写 eventfd */
+	if (!signaled_.exchange(true, std::memory_order_acq_rel)) {
+		uint64_t one = 1;
+		ssize_t n = write(eventFd_, &one, sizeof(one));
+		(void)n;
+	}
+}
+
+void CompletionQueue::Acknowledge() {
+	uint64_t count;
+	ssize_t n = read(eventFd_, &count, sizeof(count));
+	(void)n;
+	signaled_.exchange(false, std::memory_order_acq_rel);
+}
+
+/* Vyukov 侵入式 MPSC 队列：生产者只交换 head_，消费者独占 tail_ */
+CompletionQueue::Node *CompletionQueue::Pop() {
+	Node *tail = tail_;
+	Node *next = tail->next.load(std::memory_order_acquire);
+	if (tail == &stub_) {
+		if (!next) { return nullptr; }
+		tail_ = next;
+		tail = next;
+		next = next->next.load(std::memory_order_acquire);
+	}
+	if (next) {
+		tail_ = next;
+		return tail;
+	}
+	if (tail != head_.load(std::memory_order_acquire)) {
+		/* 有生产者交换了 head_ 但还没链接上，它随后会写 eventfd，下轮再取 */
+		return nullptr;
+	}
+	Link_(&stub_);
+	next = tail->next.load(std::memory_order_acquire);
+	if (next) {
+		tail_ = next;
+		return tail;
+	}
+	return nullptr;
+}
@@ -0,0 +1,63 @@
+//
+// Created by moon on 25-3-24.
+//
+
+#ifndef COMPLETION_QUEUE_H
+#define COMPLETION_QUEUE_H
+
+#include <atomic>
+#include <cstdint>
+#include <unistd.h>
+#include <sys/eventfd.h>
+
+// 工作线程 -> Reactor 的完成队列（多生产者单消费者，无锁）
+// 工作线程处理完连接后只投递结果，由 Reactor 线程统一修改 epoll 和定时器；
+// 结点嵌在连接对象里，EPOLLONESHOT 保证同一连接同时最多一个结点在途，投递不分配内存。
+// 队列由空变为非空时写一次 eventfd 唤醒 epoll_wait，同一轮的多次投递只唤醒一次。
+class CompletionQueue {
+public:
+	enum Action {
+		REARM_READ = 0,   // 重新注册 EPOLLIN
+		REARM_WRITE,      // 重新注册 EPOLLOUT
+		CLOSE,            // 关闭连接
+	};
+
+	struct Node {
+		std::atomic<Node *> next;
+		int fd;
+		Action action;
+
+		Node() : next(nullptr), fd(-1), action(REARM_READ) {}
+	};
+
+	CompletionQueue();
+
+	~CompletionQueue();
+
+	CompletionQueue(const CompletionQueue &) = delete;
+
+	CompletionQueue &operator=(const CompletionQueue &) = delete;
+
+	// 供 epoll 监听的 eventfd
+	int Fd() const { return eventFd_; }
+
+	// 任意线程：投递一个结点（结点在被 Pop 取出前不得再次投递）
+	void Push(Node *node);
+
+	// 仅 Reactor 线程：清除唤醒标记，之后逐个 Pop 直到返回 nullptr
+	void Acknowledge();
+
+	// 仅 Reactor 线程：取出一个结点，队列为空（或生产者尚未链接完成）时返回 nullptr
+	Node *Pop();
+
+private:
+	void Link_(Node *node);
+
+	int eventFd_;
+	std::atomic<bool> signaled_;
+	std::atomic<Node *> head_;   // 生产者端
+	Node *tail_;                 // 消费者端
+	Node stub_;
+};
+
+#endif //COMPLETION_QUEUE_H
@@ -6,6 +6,7 @@
  */
 
 #include "httpserver.h"
+#include <algorithm>
 
 using namespace std;
 
@@ -13,19 +14,41 @@ HttpServer::HttpServer(
             int port, int trigMode, int timeoutMS, bool OptLinger,
             int sqlPort, const char* sqlUser, const  char* sqlPwd,
             const char* dbName, int connPoolNum, int threadNum,
-            bool openLog, int logLevel, int logQueSize):
-            port_(port), openLinger_(OptLinger), timeoutMS_(timeoutMS), isClose_(false),
-            timer_(new HeapTimer()), threadpool_(new ThreadPool(threadNum)), epoller_(new Epoller())
+            bool openLog, int logLevel, int logQueSize, bool preload,
+            const char* resourceArchive, bool inlineStatic, bool affinity, bool pinThreads, const char* nic,
+            int blockingThreadNum, size_t cpuQueueMax, size_t blockingQueueMax):
+            port_(port), openLinger_(OptLinger), timeoutMS_(timeoutMS), isClose_(false), inlineStatic_(inlineStatic),
+            pinThreads_(pinThreads), reactorCpu_(-1),
+            timer_(new HeapTimer()), ioPool_(new ThreadPool(IO_THREAD_NUM)), epoller_(new Epoller()),
+            completions_(new CompletionQueue())
     {
+    /* 此后缓存配置只读：工作线程无锁读取，资源镜像按它预生成响应头 */
+    HttpResponse::LockCacheConfig();
+    /* 线程数为 0 时按可用 CPU（含 cgroup 配额）确定 */
+    if(threadNum <= 0) { threadNum = CpuTopology::AvailableCpus(); }
+    PlanPlacement_(nic);
+    ThreadPool::StartHook onStart = nullptr;
+    if(pinThreads_ && !workerCpus_.empty()) { onStart = [this](size_t id) { PinWorker_(id); }; }
+    threadpool_.reset(new ThreadPool(threadNum, affinity, onStart));
+    threadpool_->SetQueueLimit(cpuQueueMax);
+    /* 阻塞通道的线程数默认与数据库连接数相同，更多线程只会阻塞在取连接上 */
+    if(blockingThreadNum <= 0) { blockingThreadNum = connPoolNum; }
+    blockingPool_.reset(new ThreadPool(blockingThreadNum));
+    blockingPool_->SetQueueLimit(blockingQueueMax);
+
     srcDir_ = getcwd(nullptr, 256);
     assert(srcDir_);
     strncat(srcDir_, "/resources/", 16);
     HttpConn::userCount = 0;
     HttpConn::srcDir = srcDir_;
+    HttpResponse::keepAliveTimeout = timeoutMS_ > 0 ? timeoutMS_ / 1000 : 0;
     SqlConnPool::Instance()->Init("localhost", sqlPort, sqlUser, sqlPwd, dbName, connPoolNum);
+    SqlBatchWriter::Instance()->Init(SqlConnPool::Instance());
+    HttpRequest::InitRoutes();
 
     InitEventMode_(trigMode);
     if(!InitSocket_()) { isClose_ = true;}
+    if(!isClose_ && !epoller_->AddFd(completions_->Fd(), EPOLLIN)) { isClose_ = true; }
 
     if(openLog) {
         Logger::GetInstance()->Initialize(logLevel, "./log", ".log", logQueSize);
@@ -38,15 +61,29 @@ HttpServer::HttpServer(
                             (connEvent_ & EPOLLET ? "ET": "LT"));
             LOG_INFO("LogSys level: %d", logLevel);
             LOG_INFO("srcDir: %s", HttpConn::srcDir);
-            LOG_INFO("SqlConnPool num: %d, ThreadPool num: %d", connPoolNum, threadNum);
+            LOG_INFO("SqlConnPool num: %d, ThreadPool num: %d (queue %zu), Blocking num: %d (queue %zu)",
+                            connPoolNum, threadNum, cpuQueueMax, blockingThreadNum, blockingQueueMax);
+            LOG_INFO("Inline static: %s, Worker affinity: %s", inlineStatic_ ? "true" : "false",
+                            affinity ? "true" : "false");
+            LogPlacement_(nic);
         }
     }
+    /* 优先映射打包好的归档；预加载模式下把整个资源目录装入只读内存镜像；
+       都失败时仍按文件系统提供服务 */
+    if(resourceArchive && !ResourceImage::Instance()->Load(resourceArchive)) {
+        LOG_WARN("Load resource archive %s failed", resourceArchive);
+    }
+    if(preload && !ResourceImage::Instance()->IsLoaded() && !ResourceImage::Instance()->Build(srcDir_)) {
+        LOG_WARN("Preload resources failed, serving from filesystem");
+    }
 }
 
 HttpServer::~HttpServer() {
     close(listenFd_);
     isClose_ = true;
     free(srcDir_);
+    ResourceImage::Instance()->Unload();
+    SqlBatchWriter::Instance()->Close();
     SqlConnPool::Instance()->ClosePool();
 }
 
@@ -78,6 +115,9 @@ void HttpServer::InitEventMode_(int trigMode) {
 void HttpServer::Start() {
     int timeMS = -1;  /* epoll wait timeout == -1 无事件将阻塞 */
     if(!isClose_) { LOG_INFO("========== Server start =========="); }
+    if(pinThreads_ && reactorCpu_ >= 0 && CpuTopology::PinCurrentThread(reactorCpu_)) {
+        SlabPool::BindNode(CpuTopology::NodeOfCpu(reactorCpu_));
+    }
     while(!isClose_) {
         if(timeoutMS_ > 0) {
             timeMS = timer_->NextExpirationInMs();
@@ -90,6 +130,9 @@ void HttpServer::Start() {
             if(fd == listenFd_) {
                 DealListen_();
             }
+            else if(fd == completions_->Fd()) {
+                DealCompletions_();
+            }
             else if(events & (EPOLLRDHUP | EPOLLHUP | EPOLLERR)) {
                 assert(users_.count(fd) > 0);
                 CloseConn_(&users_[fd]);
@@ -119,11 +162,40 @@ void HttpServer::SendError_(int fd, const char*info) {
 
 void HttpServer::CloseConn_(HttpConn* client) {
     assert(client);
+    if(client->IsBusy()) {
+        /* 工作线程仍持有该连接，等它投递完成结果后再关闭 */
+        client->SetClosePending(true);
+        return;
+    }
     LOG_INFO("Client[%d] quit!", client->GetFd());
     epoller_->DelFd(client->GetFd());
+    if(timeoutMS_ > 0) { timer_->Cancel(client->GetFd()); }
     client->Close();
 }
 
+/* 工作线程（及预读线程）调用：不直接改 epoll，交给 Reactor */
+void HttpServer::Complete_(HttpConn* client, CompletionQueue::Action action) {
+    CompletionQueue::Node* node = client->CompletionNode();
+    node->fd = client->GetFd();
+    node->action = action;
+    completions_->Push(node);
+}
+
+/* Reactor 线程：取出所有完成结果，重新注册事件或关闭连接 */
+void HttpServer::DealCompletions_() {
+    completions_->Acknowledge();
+    while(CompletionQueue::Node* node = completions_->Pop()) {
+        HttpConn* client = &users_[node->fd];
+        client->SetBusy(false);
+        if(node->action == CompletionQueue::CLOSE || client->IsClosePending()) {
+            CloseConn_(client);
+            continue;
+        }
+        uint32_t events = (node->action == CompletionQueue::REARM_WRITE) ? EPOLLOUT : EPOLLIN;
+        epoller_->ModFd(node->fd, connEvent_ | events);
+    }
+}
+
 void HttpServer::AddClient_(int fd, sockaddr_in addr) {
     assert(fd > 0);
     users_[fd].init(fd, addr);
@@ -153,13 +225,26 @@ void HttpServer::DealListen_() {
 void HttpServer::DealRead_(HttpConn* client) {
     assert(client);
     ExtentTime_(client);
-    threadpool_->AddTask(std::bind(&HttpServer::OnRead_, this, client));
+    if(inlineStatic_) {
+        OnReadInline_(client);
+        return;
+    }
+    client->SetBusy(true);
+    /* 只捕获两个指针，落在 std::function 的内联存储里，每次派发不分配内存；
+       按 fd 派发，同一连接的任务落在同一工作线程上；
+       CPU 通道排满时由 Reactor 自己执行，接收新请求随之放缓，形成背压 */
+    if(!threadpool_->TryAddTask(client->GetFd(), [this, client] { OnRead_(client); })) {
+        OnRead_(client);
+    }
 }
 
 void HttpServer::DealWrite_(HttpConn* client) {
     assert(client);
     ExtentTime_(client);
-    threadpool_->AddTask(std::bind(&HttpServer::OnWrite_, this, client));
+    client->SetBusy(true);
+    if(!threadpool_->TryAddTask(client->GetFd(), [this, client] { OnWrite_(client); })) {
+        OnWrite_(client);
+    }
 }
 
 void HttpServer::ExtentTime_(HttpConn* client) {
@@ -173,17 +258,72 @@ void HttpServer::OnRead_(HttpConn* client) {
     int readErrno = 0;
     ret = client->read(&readErrno);
     if(ret <= 0 && readErrno != EAGAIN) {
-        CloseConn_(client);
+        Complete_(client, CompletionQueue::CLOSE);
         return;
     }
     OnProcess(client);
 }
 
+/* Reactor 线程直接读取并解析：缓存命中的静态请求当场写回，省去线程切换；
+   可能阻塞的请求交给线程池，未写完的大响应也由线程池在 EPOLLOUT 时继续发送 */
+void HttpServer::OnReadInline_(HttpConn* client) {
+    int readErrno = 0;
+    int ret = client->read(&readErrno);
+    if(ret <= 0 && readErrno != EAGAIN) {
+        CloseConn_(client);
+        return;
+    }
+    while(true) {
+        HttpConn::InlineResult result = client->ProcessInline();
+        if(result == HttpConn::INLINE_NEED_READ) {
+            epoller_->ModFd(client->GetFd(), connEvent_ | EPOLLIN);
+            return;
+        }
+        if(result == HttpConn::INLINE_DEFER) {
+            client->SetBusy(true);
+            if(!threadpool_->TryAddTask(client->GetFd(), [this, client] { OnProcess(client); })) {
+                OnProcess(client);
+            }
+            return;
+        }
+        int writeErrno = 0;
+        ret = client->write(&writeErrno);
+        if(client->NeedWarm()) {
+            client->SetBusy(true);
+            WarmFile_(client);
+            return;
+        }
+        if(client->ToWriteBytes() == 0) {
+            /* 传输完成，继续处理同一连接上已到达的下一个请求 */
+            if(client->IsKeepAlive()) { continue; }
+        }
+        else if(ret < 0 && writeErrno == EAGAIN) {
+            epoller_->ModFd(client->GetFd(), connEvent_ | EPOLLOUT);
+            return;
+        }
+        CloseConn_(client);
+        return;
+    }
+}
+
+/* 按路由的处理函数类型分通道：阻塞的处理函数转到阻塞通道执行，慢后端不会占满 CPU 通道；
+   阻塞通道排满时直接返回 503 */
 void HttpServer::OnProcess(HttpConn* client) {
+    bool ready = client->process(false);
+    if(client->NeedBlocking()) {
+        if(blockingPool_->TryAddTask([this, client] { OnBlocking_(client); })) { return; }
+        LOG_WARN("Blocking lane full, client[%d] rejected", client->GetFd());
+        client->Reject(503);
+        ready = true;
+    }
+    Complete_(client, ready ? CompletionQueue::REARM_WRITE : CompletionQueue::REARM_READ);
+}
+
+void HttpServer::OnBlocking_(HttpConn* client) {
     if(client->process()) {
-        epoller_->ModFd(client->GetFd(), connEvent_ | EPOLLOUT);
+        Complete_(client, CompletionQueue::REARM_WRITE);
     } else {
-        epoller_->ModFd(client->GetFd(), connEvent_ | EPOLLIN);
+        Complete_(client, CompletionQueue::REARM_READ);
     }
 }
 
@@ -192,6 +332,11 @@ void HttpServer::OnWrite_(HttpConn* client) {
     int ret = -1;
     int writeErrno = 0;
     ret = client->write(&writeErrno);
+    if(client->NeedWarm()) {
+        /* 文件内容不在页缓存中，预读完成后再继续发送 */
+        WarmFile_(client);
+        return;
+    }
     if(client->ToWriteBytes() == 0) {
         /* 传输完成 */
         if(client->IsKeepAlive()) {
@@ -202,11 +347,97 @@ void HttpServer::OnWrite_(HttpConn* client) {
     else if(ret < 0) {
         if(writeErrno == EAGAIN) {
             /* 继续传输 */
-            epoller_->ModFd(client->GetFd(), connEvent_ | EPOLLOUT);
+            Complete_(client, CompletionQueue::REARM_WRITE);
             return;
         }
     }
-    CloseConn_(client);
+    Complete_(client, CompletionQueue::CLOSE);
+}
+
+void HttpServer::WarmFile_(HttpConn* client) {
+    string path;
+    off_t offset;
+    size_t len;
+    client->TakeWarm(&path, &offset, &len);
+    /* 预读期间连接仍为 busy，超时不会关闭它；预读线程只读文件、不访问连接的映射 */
+    ioPool_->AddTask([this, path, offset, len, client]() {
+        ReadAhead_(path, offset, len);
+        Complete_(client, CompletionQueue::REARM_WRITE);
+    });
+}
+
+void HttpServer::ReadAhead_(const string& path, off_t offset, size_t len) {
+    int fd = open(path.c_str(), O_RDONLY);
+    if(fd < 0) { return; }
+    posix_fadvise(fd, offset, len, POSIX_FADV_WILLNEED);
+    /* 同步读入页缓存，返回时该区间已驻留 */
+    static thread_local std::vector<char> scratch(256 * 1024);
+    size_t done = 0;
+    while(done < len) {
+        ssize_t n = pread(fd, scratch.data(), min(scratch.size(), len - done), offset + done);
+        if(n <= 0) { break; }
+        done += n;
+    }
+    close(fd);
+    LOG_DEBUG("Read ahead %s [%ld, +%zu)", path.c_str(), (long)offset, done);
+}
+
+/* 规划各线程所在的核：指定网卡时优先使用网卡所在 NUMA 节点的 CPU；
+   Reactor 放在处理网卡中断的核上，与收包软中断共享缓存，工作线程尽量避开这些核 */
+void HttpServer::PlanPlacement_(const char* nic) {
+    vector<int> cpus = CpuTopology::AllowedCpus();
+    if(cpus.empty()) { return; }
+    int nicNode = CpuTopology::NodeOfNic(nic);
+    vector<int> irqCpus = CpuTopology::IrqCpus(nic);
+    auto isIrq = [&irqCpus](int cpu) { return find(irqCpus.begin(), irqCpus.end(), cpu) != irqCpus.end(); };
+    auto remote = [nicNode](int cpu) { return nicNode >= 0 && CpuTopology::NodeOfCpu(cpu) != nicNode; };
+    stable_sort(cpus.begin(), cpus.end(), [&](int a, int b) {
+        return remote(a) * 2 + isIrq(a) < remote(b) * 2 + isIrq(b);
+    });
+
+    reactorCpu_ = cpus[0];
+    for(int cpu: cpus) {
+        if(isIrq(cpu) && !remote(cpu)) {
+            reactorCpu_ = cpu;
+            break;
+        }
+    }
+    workerCpus_.clear();
+    for(int cpu: cpus) {
+        if(cpu != reactorCpu_ || cpus.size() == 1) { workerCpus_.push_back(cpu); }
+    }
+}
+
+void HttpServer::LogPlacement_(const char* nic) {
+    auto join = [](const vector<int>& cpus) {
+        string list;
+        for(int cpu: cpus) { list += (list.empty() ? "" : ",") + to_string(cpu); }
+        return list;
+    };
+    LOG_INFO("CPUs available: %d, Pin threads: %s, Reactor CPU: %d, Worker CPUs: %s",
+             CpuTopology::AvailableCpus(), pinThreads_ ? "true" : "false", reactorCpu_, join(workerCpus_).c_str());
+    if(!nic) { return; }
+    vector<int> irqCpus = CpuTopology::IrqCpus(nic);
+    LOG_INFO("NIC %s: NUMA node %d, IRQ CPUs: %s", nic, CpuTopology::NodeOfNic(nic), join(irqCpus).c_str());
+    /* 中断亲和由系统管理，这里只给出建议 */
+    if(irqCpus.empty()) {
+        LOG_WARN("No IRQ of %s found, consider steering its queues to CPU %d (/proc/irq/N/smp_affinity_list)",
+                 nic, reactorCpu_);
+    }
+    for(int cpu: irqCpus) {
+        if(cpu != reactorCpu_ && find(workerCpus_.begin(), workerCpus_.end(), cpu) != workerCpus_.end()) {
+            LOG_WARN("IRQs of %s also land on worker CPU %d, consider steering them to CPU %d", nic, cpu, reactorCpu_);
+            break;
+        }
+    }
+}
+
+/* 工作线程启动时绑核，并让其后新分配的缓冲区落在本节点 */
+void HttpServer::PinWorker_(size_t id) {
+    int cpu = workerCpus_[id % workerCpus_.size()];
+    if(CpuTopology::PinCurrentThread(cpu)) {
+        SlabPool::BindNode(CpuTopology::NodeOfCpu(cpu));
+    }
 }
 
 /* Create listenFd */
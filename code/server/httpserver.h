@@ -16,11 +16,14 @@
 #include <arpa/inet.h>
 
 #include "epoller.h"
+#include "completionqueue.h"
 #include "../log/log.h"
 #include "../timer/heaptimer.h"
 #include "../pool/sqlconnpool.h"
 #include "../pool/threadpool.h"
+#include "../pool/cputopology.h"
 #include "../pool/sqlconnRAII.h"
+#include "../pool/sqlbatchwriter.h"
 #include "../http/http_connection.h"
 
 class HttpServer {
@@ -29,7 +32,10 @@ public:
 		int port, int trigMode, int timeoutMS, bool OptLinger,
 		int sqlPort, const char* sqlUser, const  char* sqlPwd,
 		const char* dbName, int connPoolNum, int threadNum,
-		bool openLog, int logLevel, int logQueSize);
+		bool openLog, int logLevel, int logQueSize, bool preload = false,
+		const char* resourceArchive = nullptr, bool inlineStatic = true, bool affinity = true,
+		bool pinThreads = false, const char* nic = nullptr,
+		int blockingThreadNum = 0, size_t cpuQueueMax = 0, size_t blockingQueueMax = 256);
 
 	~HttpServer();
 	void Start();
@@ -46,12 +52,24 @@ private:
 	void SendError_(int fd, const char*info);
 	void ExtentTime_(HttpConn* client);
 	void CloseConn_(HttpConn* client);
+	void Complete_(HttpConn* client, CompletionQueue::Action action);
+	void DealCompletions_();
 
 	void OnRead_(HttpConn* client);
+	void OnReadInline_(HttpConn* client);
 	void OnWrite_(HttpConn* client);
 	void OnProcess(HttpConn* client);
+	void OnBlocking_(HttpConn* client);
+	void WarmFile_(HttpConn* client);
+
+	void PlanPlacement_(const char* nic);
+	void LogPlacement_(const char* nic);
+	void PinWorker_(size_t id);
+
+	static void ReadAhead_(const std::string& path, off_t offset, size_t len);
 
 	static const int MAX_FD = 65536;
+	static const int IO_THREAD_NUM = 4;   // 冷文件预读线程数
 
 	static int SetFdNonblock(int fd);
 
@@ -59,15 +77,23 @@ private:
 	bool openLinger_;
 	int timeoutMS_;  /* 毫秒MS */
 	bool isClose_;
+	bool inlineStatic_;  /* Reactor 线程直接处理缓存命中的静态请求 */
 	int listenFd_;
 	char* srcDir_;
 
+	bool pinThreads_;
+	int reactorCpu_;                 /* 规划的 Reactor 所在核，-1 为不绑定 */
+	std::vector<int> workerCpus_;    /* 各工作线程依次绑定的核 */
+
 	uint32_t listenEvent_;
 	uint32_t connEvent_;
 
 	std::unique_ptr<HeapTimer> timer_;
-	std::unique_ptr<ThreadPool> threadpool_;
+	std::unique_ptr<ThreadPool> threadpool_;   // CPU 通道：读写、解析、静态响应
+	std::unique_ptr<ThreadPool> blockingPool_; // 阻塞通道：数据库等阻塞的处理函数，有界
+	std::unique_ptr<ThreadPool> ioPool_;     // 冷文件预读，避免阻塞工作线程
 	std::unique_ptr<Epoller> epoller_;
+	std::unique_ptr<CompletionQueue> completions_;  // 工作线程投递的结果，只有 Reactor 线程操作 epoll 和定时器
 	std::unordered_map<int, HttpConn> users_;
 };
 
@@ -50,6 +50,16 @@ void HeapTimer::TriggerAndRemove(int id)
 	RemoveByIndex(i);
 }
 
+void HeapTimer::Cancel(int id)
+{
+	auto it = ref.find(id);
+	if (it == ref.end())
+	{
+		return;
+	}
+	RemoveByIndex(it->second);
+}
+
 void HeapTimer::clear()
 {
 	ref.clear();
@@ -65,13 +75,14 @@ void HeapTimer::ProcessExpiredTimers()
 	}
 	while (!heap.empty())
 	{
-		TimerNode node = heap.front();
-		if (std::chrono::duration_cast<MS>(node.expires - Clock::now()).count() > 0)
+		/* 只在超时时取出回调（移动而非拷贝），未超时的检查不复制结点 */
+		if (std::chrono::duration_cast<MS>(heap.front().expires - Clock::now()).count() > 0)
 		{
 			break;
 		}
-		node.cb();
+		TimeoutCallBack cb = std::move(heap.front().cb);
 		ExtractTop();
+		cb();
 	}
 }
 
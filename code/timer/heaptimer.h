@@ -42,6 +42,7 @@ public:
 	void Reschedule(int id, int newExpires); // 调整指定ID的定时器超时时间
 	void Schedule(int id, int timeOut, const TimeoutCallBack &cb); // 添加新定时器
 	void TriggerAndRemove(int id); // 立即执行指定ID的回调并删除定时器
+	void Cancel(int id); // 删除指定ID的定时器（不执行回调），不存在时忽略
 	void clear(); // 清空所有定时器
 	void ProcessExpiredTimers(); // 处理所有已超时的定时器
 	void ExtractTop(); // 删除堆顶元素（最小超时任务）
@@ -0,0 +1,159 @@
+//
+// Created by moon on 25-3-28.
+//
+
+// GET 路径的堆分配检查：替换 malloc 系列函数计数（operator new 也经由 malloc），
+// 通过 socketpair 向 HttpConn 连续发送长连接 GET 请求，按服务端的调用顺序 read -> process -> write，
+// 预热之后仍有堆分配则返回非零。用法：alloccheck [资源目录] [请求数]
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <atomic>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/socket.h>
+
+#include "../http/http_connection.h"
+
+extern "C" {
+void *__libc_malloc(size_t size);
+void *__libc_calloc(size_t n, size_t size);
+void *__libc_realloc(void *ptr, size_t size);
+void *__libc_memalign(size_t alignment, size_t size);
+void __libc_free(void *ptr);
+}
+
+namespace {
+
+std::atomic<bool> counting(false);
+std::atomic<long> allocations(0);
+
+inline void Count() {
+	if (counting.load(std::memory_order_relaxed)) {
+		allocations.fetch_add(1, std::memory_order_relaxed);
+	}
+}
+
+}
+
+// glibc 下替换这几个符号即可覆盖进程内所有的堆分配
+extern "C" {
+void *malloc(size_t size) {
+	Count();
+	return __libc_malloc(size);
+}
+
+void *calloc(size_t n, size_t size) {
+	Count();
+	return __libc_calloc(n, size);
+}
+
+void *realloc(void *ptr, size_t size) {
+	Count();
+	return __libc_realloc(ptr, size);
+}
+
+void *memalign(size_t alignment, size_t size) {
+	Count();
+	return __libc_memalign(alignment, size);
+}
+
+int posix_memalign(void **ptr, size_t alignment, size_t size) {
+	Count();
+	*ptr = __libc_memalign(alignment, size);
+	return *ptr ? 0 : ENOMEM;
+}
+
+void *aligned_alloc(size_t alignment, size_t size) {
+	Count();
+	return __libc_memalign(alignment, size);
+}
+
+void free(void *ptr) {
+	__libc_free(ptr);
+}
+}
+
+namespace {
+
+const char *const PATHS[] = {"/", "/index.html", "/login", "/404.html"};
+const int PATH_COUNT = sizeof(PATHS) / sizeof(PATHS[0]);
+
+char request[PATH_COUNT][256];
+char response[64 * 1024];
+
+// 读完对端已发出的全部数据（客户端一侧为非阻塞）
+size_t Drain(int fd) {
+	size_t total = 0;
+	ssize_t n;
+	while ((n = read(fd, response, sizeof(response))) > 0) { total += n; }
+	return total;
+}
+
+// 一次完整的请求：客户端发送，服务端读、处理、写到写完，再像 OnWrite_ 一样为长连接调用一次 process
+bool RoundTrip(HttpConn &conn, int client, const char *req) {
+	size_t len = strlen(req);
+	if (write(client, req, len) != static_cast<ssize_t>(len)) { return false; }
+	int err = 0;
+	ssize_t n = conn.read(&err);   /* 边缘触发下读到 EAGAIN 为止，与 OnRead_ 一样视为正常 */
+	if ((n == 0 || (n < 0 && err != EAGAIN)) || !conn.process()) { return false; }
+	size_t received = 0;
+	while (conn.ToWriteBytes() > 0) {
+		if (conn.write(&err) < 0 && err != EAGAIN) { return false; }
+		received += Drain(client);
+	}
+	received += Drain(client);
+	if (received == 0 || !conn.IsKeepAlive()) { return false; }
+	conn.process();
+	return true;
+}
+
+}
+
+int main(int argc, char *argv[]) {
+	HttpConn::srcDir = argc > 1 ? argv[1] : "../resources/";
+	long requests = argc > 2 ? atol(argv[2]) : 1000;
+	long warmup = 100;
+	HttpConn::isET = true;
+	for (int i = 0; i < PATH_COUNT; i++) {
+		snprintf(request[i], sizeof(request[i]),
+		         "GET %s HTTP/1.1\r\nHost: localhost\r\nConnection: keep-alive\r\n"
+		         "Accept-Encoding: gzip, deflate\r\n\r\n", PATHS[i]);
+	}
+	HttpRequest::InitRoutes();
+
+	int fds[2];
+	if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) < 0) {
+		perror("socketpair");
+		return 1;
+	}
+	fcntl(fds[0], F_SETFL, fcntl(fds[0], F_GETFL) | O_NONBLOCK);
+	fcntl(fds[1], F_SETFL, fcntl(fds[1], F_GETFL) | O_NONBLOCK);
+
+	HttpConn conn;
+	sockaddr_in addr = {};
+	conn.init(fds[0], addr);
+
+	for (long i = 0; i < warmup; i++) {
+		if (!RoundTrip(conn, fds[1], request[i % PATH_COUNT])) {
+			fprintf(stderr, "request %s failed during warm-up\n", PATHS[i % PATH_COUNT]);
+			return 1;
+		}
+	}
+	counting = true;
+	for (long i = 0; i < requests; i++) {
+		if (!RoundTrip(conn, fds[1], request[i % PATH_COUNT])) {
+			counting = false;
+			fprintf(stderr, "request %s failed\n", PATHS[i % PATH_COUNT]);
+			return 1;
+		}
+	}
+	counting = false;
+
+	long count = allocations.load();
+	printf("%ld keep-alive GETs after %ld warm-up: %ld heap allocations\n", requests, warmup, count);
+	conn.Close();
+	close(fds[1]);
+	return count == 0 ? 0 : 1;
+}
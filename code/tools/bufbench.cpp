@@ -0,0 +1,137 @@
+//
+// Created by moon on 25-3-28.
+//
+
+// Buffer 读写位置与重置的微基准，对比改动前的实现（下面的 OldBuffer：
+// vector 存储、std::atomic 读写位置、重置时 bzero 整个存储区、读空后不回到头部）。
+//   reset：追加一行日志后重置，即日志缓冲区的用法
+//   cursor：追加一个请求后按行消费到读空，即连接读缓冲区的用法
+// 两者的存储区容量相同。用法：bufbench [迭代次数]
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <strings.h>    // bzero
+#include <string>
+#include <vector>
+#include <atomic>
+#include <chrono>
+#include <algorithm>
+
+#include "../buffer/buffer.h"
+
+using namespace std;
+
+namespace {
+
+// 改动前的 Buffer（只保留基准用到的操作）
+class OldBuffer {
+public:
+	explicit OldBuffer(size_t initialSize) : storage(initialSize), readPosition(0), writePosition(0) {}
+
+	size_t GetWritableBytes() const { return storage.size() - writePosition; }
+
+	size_t GetReadableBytes() const { return writePosition - readPosition; }
+
+	const char *GetReadPointer() const { return &storage[0] + readPosition; }
+
+	void ConsumeData(size_t len) { readPosition += len; }
+
+	void ResetReadWritePositions() {
+		bzero(&storage[0], storage.size());
+		readPosition = 0;
+		writePosition = 0;
+	}
+
+	void Append(const char *data, size_t len) {
+		if (GetWritableBytes() < len) { ManageBufferSpace_(len); }
+		copy(data, data + len, &storage[0] + writePosition);
+		writePosition += len;
+	}
+
+private:
+	void ManageBufferSpace_(size_t required) {
+		if (required - GetWritableBytes() > readPosition) {
+			storage.resize(max(storage.size() * 3 / 2, writePosition + required));
+		} else {
+			size_t stored = GetReadableBytes();
+			copy(&storage[0] + readPosition, &storage[0] + writePosition, &storage[0]);
+			readPosition = 0;
+			writePosition = stored;
+		}
+	}
+
+	vector<char> storage;
+	atomic<size_t> readPosition;
+	atomic<size_t> writePosition;
+};
+
+const char LOG_LINE[] = "2025-03-28 10:21:07.123456 [info] : Client[12](127.0.0.1:52344) in, userCount:37\n";
+
+const char REQUEST[] =
+	"GET /static/js/app.3f9a1c.js?v=20250318 HTTP/1.1\r\n"
+	"Host: www.example.com\r\n"
+	"Connection: keep-alive\r\n"
+	"User-Agent: Mozilla/5.0 (Windows NT 10.0; Win64; x64) AppleWebKit/537.36 (KHTML, like Gecko) "
+	"Chrome/122.0.0.0 Safari/537.36\r\n"
+	"Accept: */*\r\n"
+	"Referer: https://www.example.com/index.html\r\n"
+	"Accept-Encoding: gzip, deflate, br, zstd\r\n"
+	"Accept-Language: zh-CN,zh;q=0.9,en;q=0.8\r\n"
+	"Cookie: session=8f14e45fceea167a5a36dedd4bea2543; theme=dark\r\n"
+	"\r\n";
+
+template<class B>
+size_t ResetCycle(B &buff) {
+	buff.Append(LOG_LINE, sizeof(LOG_LINE) - 1);
+	size_t len = buff.GetReadableBytes();
+	buff.ResetReadWritePositions();
+	return len;
+}
+
+// 按行消费，行尾用 memchr 查找，与解析器的消费方式一致
+template<class B>
+size_t CursorCycle(B &buff) {
+	buff.Append(REQUEST, sizeof(REQUEST) - 1);
+	size_t lines = 0;
+	while (buff.GetReadableBytes()) {
+		const char *begin = buff.GetReadPointer();
+		const char *lf = static_cast<const char *>(memchr(begin, '\n', buff.GetReadableBytes()));
+		buff.ConsumeData(lf - begin + 1);
+		lines++;
+	}
+	return lines;
+}
+
+template<class F>
+double Time(long iterations, F cycle) {
+	volatile size_t sink = 0;
+	for (long i = 0; i < iterations / 100 + 1; i++) { sink += cycle(); }   // 预热
+	auto start = chrono::steady_clock::now();
+	for (long i = 0; i < iterations; i++) { sink += cycle(); }
+	(void)sink;
+	return chrono::duration<double, nano>(chrono::steady_clock::now() - start).count() / iterations;
+}
+
+}
+
+int main(int argc, char *argv[]) {
+	long iterations = argc > 1 ? atol(argv[1]) : 1000000;
+	if (iterations <= 0) { iterations = 1; }
+
+	Buffer buff;
+	OldBuffer old(buff.Capacity());
+	if (CursorCycle(buff) != CursorCycle(old)) {
+		fprintf(stderr, "cursor result mismatch\n");
+		return 1;
+	}
+	printf("capacity %zu bytes, %ld iterations\n", buff.Capacity(), iterations);
+	printf("%-8s %14s %14s  (ns/cycle)\n", "", "old", "buffer");
+	printf("%-8s %14.1f %14.1f\n", "reset",
+	       Time(iterations, [&old] { return ResetCycle(old); }),
+	       Time(iterations, [&buff] { return ResetCycle(buff); }));
+	printf("%-8s %14.1f %14.1f\n", "cursor",
+	       Time(iterations, [&old] { return CursorCycle(old); }),
+	       Time(iterations, [&buff] { return CursorCycle(buff); }));
+	return 0;
+}
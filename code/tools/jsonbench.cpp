@@ -0,0 +1,117 @@
+//
+// Created by moon on 25-3-28.
+//
+
+// 请求体解析的微基准：同样字段、同样大小（1~16 KB）的请求体分别以
+//   application/json                   JsonDoc 建索引 + 顶层成员并入 post_（ParseJson_）
+//   application/x-www-form-urlencoded  ParseFromUrlencoded_
+// 通过 HttpRequest::parse 解析完整的 POST 请求，另单独给出 JsonDoc::Parse 的耗时。
+// 用法：jsonbench [迭代次数]
+
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <chrono>
+
+#include "../http/httprequest.h"
+#include "../http/json.h"
+#include "../buffer/arena.h"
+#include "../buffer/buffer.h"
+
+using namespace std;
+
+namespace {
+
+// 依次生成 field<i>=value<i>，最后用 pad 字段补齐到恰好 size 字节
+string MakeUrlencoded(size_t size) {
+	string body;
+	for (int i = 0; body.size() + 40 < size; i++) {
+		if (!body.empty()) { body += '&'; }
+		body += "field" + to_string(i) + "=value+" + to_string(i * 7919) + "%21";
+	}
+	body += body.empty() ? "pad=" : "&pad=";
+	if (body.size() < size) { body.append(size - body.size(), 'x'); }
+	return body;
+}
+
+string MakeJson(size_t size) {
+	string body = "{";
+	for (int i = 0; body.size() + 40 < size; i++) {
+		if (body.size() > 1) { body += ','; }
+		body += "\"field" + to_string(i) + "\":\"value " + to_string(i * 7919) + "!\"";
+	}
+	body += body.size() > 1 ? ",\"pad\":\"" : "\"pad\":\"";
+	if (body.size() + 2 < size) { body.append(size - body.size() - 2, 'x'); }
+	body += "\"}";
+	return body;
+}
+
+string MakeRequest(const char *type, const string &body) {
+	return string("POST /bench HTTP/1.1\r\nHost: localhost\r\nContent-Type: ") + type
+	       + "\r\nContent-Length: " + to_string(body.size()) + "\r\n\r\n" + body;
+}
+
+// 每轮把请求放进读缓冲区并完整解析一次，返回每个请求的平均纳秒数；失败返回负数
+double TimeRequest(const string &request, long iterations) {
+	Buffer buff;
+	HttpRequest parser;
+	size_t sink = 0;
+	auto start = chrono::steady_clock::now();
+	for (long i = 0; i < iterations; i++) {
+		parser.Init();
+		buff.ResetReadWritePositions();
+		buff.Append(request.data(), request.size());
+		if (!parser.parse(buff) || !parser.IsFinished()) { return -1; }
+		sink += parser.GetPost("pad").size();
+	}
+	double ns = chrono::duration<double, nano>(chrono::steady_clock::now() - start).count() / iterations;
+	return sink ? ns : -1;
+}
+
+double TimeJsonDoc(const string &body, long iterations) {
+	Arena arena;
+	JsonDoc doc;
+	size_t sink = 0;
+	auto start = chrono::steady_clock::now();
+	for (long i = 0; i < iterations; i++) {
+		arena.Reset();
+		if (!doc.Parse(body.data(), body.size(), &arena)) { return -1; }
+		sink += doc.Root().Size();
+	}
+	double ns = chrono::duration<double, nano>(chrono::steady_clock::now() - start).count() / iterations;
+	return sink ? ns : -1;
+}
+
+}
+
+int main(int argc, char *argv[]) {
+	long iterations = argc > 1 ? atol(argv[1]) : 20000;
+	if (iterations <= 0) { iterations = 1; }
+	printf("%ld iterations, json impl: %s\n", iterations, JsonDoc::Impl());
+	printf("%8s %14s %14s %14s  (ns/request)\n", "body", "JsonDoc", "json request", "urlencoded");
+
+	for (size_t kb = 1; kb <= 16; kb *= 2) {
+		string json = MakeJson(kb * 1024);
+		string form = MakeUrlencoded(kb * 1024);
+		if (json.size() != form.size()) {
+			fprintf(stderr, "body size mismatch: %zu != %zu\n", json.size(), form.size());
+			return 1;
+		}
+		string jsonRequest = MakeRequest("application/json", json);
+		string formRequest = MakeRequest("application/x-www-form-urlencoded", form);
+
+		/* 预热 */
+		TimeRequest(jsonRequest, iterations / 100 + 1);
+		TimeRequest(formRequest, iterations / 100 + 1);
+
+		double doc = TimeJsonDoc(json, iterations);
+		double jsonNs = TimeRequest(jsonRequest, iterations);
+		double formNs = TimeRequest(formRequest, iterations);
+		if (doc < 0 || jsonNs < 0 || formNs < 0) {
+			fprintf(stderr, "%zu KB: parse failed\n", kb);
+			return 1;
+		}
+		printf("%6zuKB %14.1f %14.1f %14.1f\n", kb, doc, jsonNs, formNs);
+	}
+	return 0;
+}
@@ -0,0 +1,55 @@
+//
+// Created by moon on 25-3-23.
+//
+
+// 资源打包工具：把资源目录打成一个带索引的归档文件，格式与 ResourceImage 的内存镜像相同，
+// 服务启动时只需 mmap 该文件。用法：pack <资源目录> <输出文件>
+
+#include <cstdio>
+#include <string>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "../http/resourceimage.h"
+
+int main(int argc, char *argv[]) {
+	if (argc != 3) {
+		fprintf(stderr, "usage: %s <resource dir> <output file>\n", argv[0]);
+		return 1;
+	}
+	std::string image;
+	if (!ResourceImage::Serialize(argv[1], &image)) {
+		fprintf(stderr, "pack %s failed\n", argv[1]);
+		return 1;
+	}
+
+	/* 先写临时文件再改名，正在运行的服务映射的旧归档不受影响 */
+	std::string tmp = std::string(argv[2]) + ".tmp";
+	int fd = open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	if (fd < 0) {
+		perror(tmp.c_str());
+		return 1;
+	}
+	size_t done = 0;
+	while (done < image.size()) {
+		ssize_t n = write(fd, image.data() + done, image.size() - done);
+		if (n <= 0) {
+			perror(tmp.c_str());
+			close(fd);
+			unlink(tmp.c_str());
+			return 1;
+		}
+		done += n;
+	}
+	if (fsync(fd) < 0 || close(fd) < 0 || rename(tmp.c_str(), argv[2]) < 0) {
+		perror(argv[2]);
+		unlink(tmp.c_str());
+		return 1;
+	}
+	if (!ResourceImage::Instance()->Load(argv[2])) {
+		fprintf(stderr, "verify %s failed\n", argv[2]);
+		return 1;
+	}
+	printf("%s: %zu files, %zu bytes\n", argv[2], ResourceImage::Instance()->Count(), image.size());
+	return 0;
+}
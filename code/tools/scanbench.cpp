@@ -0,0 +1,140 @@
+//
+// Created by moon on 25-3-28.
+//
+
+// 请求解析分隔符扫描的微基准：同一个典型浏览器请求，分别用
+//   旧实现：std::search 找 "\r\n"，std::regex 切分请求行和请求头
+//   逐字节：标量循环找 '\r' / ':' / ' '
+//   Scanner：按 CPU 选择的向量实现
+// 切分请求行和所有请求头，输出每个请求的平均耗时。用法：scanbench [迭代次数]
+
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <regex>
+#include <chrono>
+#include <algorithm>
+
+#include "../http/scanner.h"
+
+using namespace std;
+
+namespace {
+
+const char REQUEST[] =
+	"GET /static/js/app.3f9a1c.js?v=20250318 HTTP/1.1\r\n"
+	"Host: www.example.com\r\n"
+	"Connection: keep-alive\r\n"
+	"sec-ch-ua: \"Chromium\";v=\"122\", \"Not(A:Brand\";v=\"24\", \"Google Chrome\";v=\"122\"\r\n"
+	"sec-ch-ua-mobile: ?0\r\n"
+	"User-Agent: Mozilla/5.0 (Windows NT 10.0; Win64; x64) AppleWebKit/537.36 (KHTML, like Gecko) "
+	"Chrome/122.0.0.0 Safari/537.36\r\n"
+	"sec-ch-ua-platform: \"Windows\"\r\n"
+	"Accept: */*\r\n"
+	"Sec-Fetch-Site: same-origin\r\n"
+	"Sec-Fetch-Mode: no-cors\r\n"
+	"Sec-Fetch-Dest: script\r\n"
+	"Referer: https://www.example.com/index.html\r\n"
+	"Accept-Encoding: gzip, deflate, br, zstd\r\n"
+	"Accept-Language: zh-CN,zh;q=0.9,en;q=0.8\r\n"
+	"Cookie: session=8f14e45fceea167a5a36dedd4bea2543; theme=dark; _ga=GA1.1.123456789.1710000000; "
+	"_gid=GA1.1.987654321.1710000000; lang=zh-CN\r\n"
+	"If-None-Match: \"1a2b3c-4d5e-6f70\"\r\n"
+	"If-Modified-Since: Mon, 17 Mar 2025 08:00:00 GMT\r\n"
+	"\r\n";
+
+const char *ScalarFind(const char *begin, const char *end, char ch) {
+	for (; begin < end; begin++) {
+		if (*begin == ch) { return begin; }
+	}
+	return end;
+}
+
+const char *ScalarCRLF(const char *begin, const char *end) {
+	for (const char *p = begin; p + 1 < end; p++) {
+		if (p[0] == '\r' && p[1] == '\n') { return p; }
+	}
+	return end;
+}
+
+// 旧实现：与改动前 HttpRequest::parse / ParseRequestLine_ / ParseHeader_ 相同
+size_t ParseRegex(const char *begin, const char *end) {
+	static const char CRLF[] = "\r\n";
+	static const regex requestLine("^([^ ]*) ([^ ]*) HTTP/([^ ]*)$");
+	static const regex header("^([^:]*): ?(.*)$");
+	size_t sum = 0;
+	bool first = true;
+	while (begin < end) {
+		const char *lineEnd = search(begin, end, CRLF, CRLF + 2);
+		if (lineEnd == end || lineEnd == begin) { break; }
+		string line(begin, lineEnd);
+		smatch subMatch;
+		if (regex_match(line, subMatch, first ? requestLine : header)) {
+			sum += subMatch[1].length() + subMatch[2].length();
+		}
+		first = false;
+		begin = lineEnd + 2;
+	}
+	return sum;
+}
+
+// 新的切分方式，查找函数可替换
+template<class FindLine, class Find>
+size_t ParseSplit(const char *begin, const char *end, FindLine findLine, Find find) {
+	size_t sum = 0;
+	bool first = true;
+	while (begin < end) {
+		const char *lineEnd = findLine(begin, end);
+		if (lineEnd == end || lineEnd == begin) { break; }
+		if (first) {
+			const char *sp1 = find(begin, lineEnd, ' ');
+			const char *sp2 = (sp1 == lineEnd) ? lineEnd : find(sp1 + 1, lineEnd, ' ');
+			sum += (sp1 - begin) + (sp2 - sp1);
+		} else {
+			const char *colon = find(begin, lineEnd, ':');
+			sum += (colon - begin) + (lineEnd - colon);
+		}
+		first = false;
+		begin = lineEnd + 2;
+	}
+	return sum;
+}
+
+template<class F>
+void Run(const char *name, long iterations, F parse) {
+	const char *begin = REQUEST;
+	const char *end = REQUEST + sizeof(REQUEST) - 1;
+	volatile size_t sink = 0;
+	for (long i = 0; i < iterations / 100 + 1; i++) { sink += parse(begin, end); }   // 预热
+	auto start = chrono::steady_clock::now();
+	for (long i = 0; i < iterations; i++) { sink += parse(begin, end); }
+	double ns = chrono::duration<double, nano>(chrono::steady_clock::now() - start).count() / iterations;
+	printf("%-16s %10.1f ns/request %8.2f GB/s\n", name, ns, (sizeof(REQUEST) - 1) / ns);
+	(void)sink;
+}
+
+}
+
+int main(int argc, char *argv[]) {
+	long iterations = argc > 1 ? atol(argv[1]) : 200000;
+	if (iterations <= 0) { iterations = 1; }
+	printf("request %zu bytes, %ld iterations, scanner impl: %s\n", sizeof(REQUEST) - 1, iterations, Scanner::Impl());
+
+	const char *begin = REQUEST;
+	const char *end = REQUEST + sizeof(REQUEST) - 1;
+	size_t expect = ParseSplit(begin, end, ScalarCRLF, ScalarFind);
+	size_t got = ParseSplit(begin, end, Scanner::FindCRLF, Scanner::FindChar);
+	if (got != expect) {
+		fprintf(stderr, "scanner result mismatch: %zu != %zu\n", got, expect);
+		return 1;
+	}
+
+	Run("search+regex", iterations / 20 + 1, ParseRegex);
+	Run("scalar", iterations, [](const char *b, const char *e) {
+		return ParseSplit(b, e, ScalarCRLF, ScalarFind);
+	});
+	Run("scanner", iterations, [](const char *b, const char *e) {
+		return ParseSplit(b, e, Scanner::FindCRLF, Scanner::FindChar);
+	});
+	return 0;
+}